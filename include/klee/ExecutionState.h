@@ -12,7 +12,9 @@
 
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Internal/ADT/BranchHistory.h"
 #include "klee/Internal/ADT/TreeStream.h"
+#include "klee/Internal/Module/BranchValueMaps.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/MergeHandler.h"
 
@@ -89,21 +91,24 @@ public:
 
   /*TODO*/
   // record the branch
-  // std::set<llvm::Value*> brSet;
-  // std::map<std::pair<llvm::Value*, unsigned char>, 
-  //         std::pair<bool, std::set<std::pair<llvm::Value*, unsigned char>>> > brSet;
-  std::map<llvm::Value*, unsigned char> brSet;
+  // Directions taken at each branch, indexed by the dense branch ID
+  // assigned by BranchDependences (see BranchDependences::getBranchID).
+  // Can also be used with llvm::Value keys, see BranchDecisionMap.
+  BranchDecisionMap brSet;
   llvm::Value* currentBr;
 
   /*TODO*/            
   // record the branchSet
-  // std::vector<std::vector<llvm::Value*> >branchSet;
-  std::map<llvm::Value*, std::set<llvm::Value*>> branchSet;
-  std::map<llvm::Value*, std::set<llvm::Value*>> dynamicSet;
+  // Branch ID -> IDs of the branches it depends on (statically resp. as
+  // observed along this path). Can also be used with llvm::Value keys and
+  // elements, see BranchDependenceMap.
+  BranchDependenceMap branchSet;
+  BranchDependenceMap dynamicSet;
 
   /*TODO*/ 
-  // record the concrete branch
-  std::vector<unsigned char> concreteBr;
+  // record the concrete branch, one bit per branch, read back as the
+  // bytes '1' (taken) and '0' as before
+  BranchHistory concreteBr;
 
   /*TODO*/
   // record the new behaviors
@@ -0,0 +1,50 @@
+//===-- BehaviorSet.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BEHAVIORSET_H
+#define KLEE_BEHAVIORSET_H
+
+#include "klee/Internal/ADT/BranchIDSet.h"
+
+#include <cstdint>
+#include <unordered_set>
+
+namespace klee {
+
+/// BehaviorSet - The set of behaviors (branch decision maps) observed so
+/// far, stored by their hash.
+///
+/// A behavior is the set of directions taken at each branch, regardless of
+/// the order and number of times they were taken, so it is coarser than
+/// the path: paths that differ only in how often or in which order they
+/// took the same directions show the same behavior.
+///
+/// Since BranchDecisions keeps its hash up to date, asking whether a path
+/// shows a new behavior is a single lookup. Two different behaviors with
+/// the same 64 bit hash are treated as one.
+class BehaviorSet {
+  std::unordered_set<uint64_t> seen;
+
+public:
+  /// Record \p decisions. Returns true if they were not seen before.
+  bool insert(const BranchDecisions &decisions) {
+    return seen.insert(decisions.getHash()).second;
+  }
+
+  bool count(const BranchDecisions &decisions) const {
+    return seen.count(decisions.getHash());
+  }
+
+  size_t size() const { return seen.size(); }
+  void clear() { seen.clear(); }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BEHAVIORSET_H */
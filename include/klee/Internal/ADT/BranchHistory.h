@@ -0,0 +1,245 @@
+//===-- BranchHistory.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BRANCHHISTORY_H
+#define KLEE_BRANCHHISTORY_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+/// BranchHistory - The sequence of directions taken by the concrete
+/// branches of a path, one bit per branch.
+///
+/// The same representation is used for binary .path files: a header
+/// followed either by the packed bits or, if shorter, by the lengths of the
+/// runs of equal directions. Long loops make the latter common.
+class BranchHistory {
+  typedef uint64_t Word;
+  static const unsigned WordBits = 64;
+
+  std::vector<Word> words;
+  uint64_t count = 0;
+
+  enum Encoding : uint8_t { Raw = 0, RunLength = 1 };
+
+  /// Number of runs of equal directions.
+  uint64_t getNumRuns() const {
+    uint64_t runs = 0;
+    for (uint64_t i = 0; i != count; ++i)
+      if (i == 0 || isTaken(i) != isTaken(i - 1))
+        ++runs;
+    return runs;
+  }
+
+public:
+  enum : uint8_t { Version = 1 };
+
+  /// Variable length integers (7 bits per byte, low bits first), as used
+  /// by the encoding.
+  static void writeVarInt(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+      out.push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+  }
+
+  static bool readVarInt(llvm::StringRef &in, uint64_t &v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (in.empty())
+        return false;
+      uint8_t byte = in.front();
+      in = in.drop_front();
+      v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  /// Magic of binary .path files; text files start with a digit.
+  static llvm::StringRef getMagic() { return llvm::StringRef("KLEEPATH", 8); }
+
+  bool empty() const { return count == 0; }
+  uint64_t size() const { return count; }
+
+  void clear() {
+    words.clear();
+    count = 0;
+  }
+
+  /// Append a decision. Takes an unsigned char like the former
+  /// std::vector<unsigned char> history, where both 1 and '1' meant taken.
+  void push_back(unsigned char taken) {
+    if (count % WordBits == 0)
+      words.push_back(0);
+    if (taken && taken != '0')
+      words.back() |= Word(1) << (count % WordBits);
+    ++count;
+  }
+
+  /// Whether the branch at \p i was taken.
+  bool isTaken(uint64_t i) const {
+    assert(i < count && "index out of range");
+    return (words[i / WordBits] >> (i % WordBits)) & 1;
+  }
+
+  /// The decision at \p i as the byte the history stored before: '1' if
+  /// the branch was taken, '0' otherwise.
+  unsigned char operator[](uint64_t i) const { return isTaken(i) ? '1' : '0'; }
+
+  unsigned char back() const { return (*this)[count - 1]; }
+
+  /// Iterates over the decisions as '0' (not taken) and '1' (taken).
+  class const_iterator {
+    const BranchHistory *history;
+    uint64_t index;
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef unsigned char value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const unsigned char *pointer;
+    typedef unsigned char reference;
+
+    const_iterator(const BranchHistory *h, uint64_t i) : history(h), index(i) {}
+
+    unsigned char operator*() const { return (*history)[index]; }
+    const_iterator &operator++() {
+      ++index;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++index;
+      return old;
+    }
+    bool operator==(const const_iterator &o) const { return index == o.index; }
+    bool operator!=(const const_iterator &o) const { return index != o.index; }
+  };
+  typedef const_iterator iterator;
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, count); }
+
+  /// The decisions one byte each, as the history was stored before.
+  operator std::vector<unsigned char>() const {
+    return std::vector<unsigned char>(begin(), end());
+  }
+
+  bool operator==(const BranchHistory &other) const {
+    return count == other.count && words == other.words;
+  }
+  bool operator!=(const BranchHistory &other) const {
+    return !(*this == other);
+  }
+
+  std::vector<bool> toVector() const {
+    std::vector<bool> result(count);
+    for (uint64_t i = 0; i != count; ++i)
+      result[i] = isTaken(i);
+    return result;
+  }
+
+  size_t getMemoryUsage() const { return words.capacity() * sizeof(Word); }
+
+  /// Append the binary .path representation to \p out.
+  void encode(std::string &out) const {
+    out.append(getMagic().data(), getMagic().size());
+    out.push_back(static_cast<char>(Version));
+
+    // a run costs at least one byte, the raw form one bit per branch
+    bool useRuns = getNumRuns() < (count + 7) / 8;
+    out.push_back(static_cast<char>(useRuns ? RunLength : Raw));
+    writeVarInt(out, count);
+    if (!count)
+      return;
+
+    if (useRuns) {
+      out.push_back(static_cast<char>(isTaken(0)));
+      uint64_t run = 1;
+      for (uint64_t i = 1; i != count; ++i) {
+        if (isTaken(i) == isTaken(i - 1)) {
+          ++run;
+        } else {
+          writeVarInt(out, run);
+          run = 1;
+        }
+      }
+      writeVarInt(out, run);
+    } else {
+      for (uint64_t i = 0, e = (count + 7) / 8; i != e; ++i)
+        out.push_back(static_cast<char>(words[i / 8] >> (i % 8 * 8)));
+    }
+  }
+
+  /// Returns true if \p data starts like a binary .path file.
+  static bool isEncoded(llvm::StringRef data) {
+    return data.startswith(getMagic());
+  }
+
+  /// Replace the history by the one encoded in \p data. Returns false if
+  /// \p data is not a valid binary .path file.
+  bool decode(llvm::StringRef data) {
+    clear();
+    if (!isEncoded(data) || data.size() < getMagic().size() + 2)
+      return false;
+    data = data.drop_front(getMagic().size());
+    uint8_t version = data[0], encoding = data[1];
+    data = data.drop_front(2);
+    uint64_t n;
+    if (version != Version || !readVarInt(data, n))
+      return false;
+    if (!n)
+      return data.empty();
+
+    if (encoding == RunLength) {
+      if (data.empty() || static_cast<uint8_t>(data.front()) > 1)
+        return false;
+      bool taken = data.front();
+      data = data.drop_front();
+      while (count != n) {
+        uint64_t run;
+        if (!readVarInt(data, run) || !run || run > n - count)
+          return false;
+        for (; run; --run)
+          push_back(taken);
+        taken = !taken;
+      }
+    } else if (encoding == Raw) {
+      if (data.size() != (n + 7) / 8)
+        return false;
+      words.assign((n + WordBits - 1) / WordBits, 0);
+      for (uint64_t i = 0; i != data.size(); ++i)
+        words[i / 8] |= Word(static_cast<uint8_t>(data[i])) << (i % 8 * 8);
+      count = n;
+      // keep the unused bits of the last word zero for operator==
+      if (n % WordBits)
+        words.back() &= (Word(1) << (n % WordBits)) - 1;
+      return true;
+    } else {
+      return false;
+    }
+    return data.empty();
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BRANCHHISTORY_H */
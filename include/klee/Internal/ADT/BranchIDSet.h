@@ -0,0 +1,471 @@
+//===-- BranchIDSet.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BRANCHIDSET_H
+#define KLEE_BRANCHIDSET_H
+
+#include "klee/Internal/ADT/ImmutableMap.h"
+#include "klee/util/Ref.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace klee {
+
+/// Dense integer ID of a conditional branch, as assigned by
+/// BranchDependences.
+typedef uint32_t BranchID;
+
+/// BranchIDSet - A set of branch IDs stored as a bit vector.
+///
+/// Only the words between the lowest and the highest element are
+/// materialized. Branches are numbered in module order, so the branches a
+/// given branch depends on mostly share a function and a few words
+/// suffice even for modules with many thousands of branches.
+class BranchIDSet {
+  typedef uint64_t Word;
+  static const unsigned WordBits = 64;
+
+  /// Index of the first materialized word.
+  unsigned base = 0;
+  std::vector<Word> words;
+
+  /// Make sure the word with index \p w is materialized.
+  void reserveWord(unsigned w) {
+    if (words.empty()) {
+      base = w;
+      words.push_back(0);
+    } else if (w < base) {
+      words.insert(words.begin(), base - w, 0);
+      base = w;
+    } else if (w >= base + words.size()) {
+      words.resize(w - base + 1, 0);
+    }
+  }
+
+  /// Drop zero words at both ends.
+  void shrink() {
+    unsigned lo = 0, hi = words.size();
+    while (lo < hi && !words[lo])
+      ++lo;
+    while (hi > lo && !words[hi - 1])
+      --hi;
+    if (lo == hi) {
+      words.clear();
+      base = 0;
+      return;
+    }
+    if (hi != words.size())
+      words.erase(words.begin() + hi, words.end());
+    if (lo) {
+      words.erase(words.begin(), words.begin() + lo);
+      base += lo;
+    }
+  }
+
+  Word getWord(unsigned w) const {
+    return (w >= base && w < base + words.size()) ? words[w - base] : 0;
+  }
+
+public:
+  class iterator {
+    const BranchIDSet *set;
+    unsigned word; // relative to set->base
+    Word rest;     // remaining bits of the current word
+
+    void advance() {
+      while (!rest) {
+        if (++word >= set->words.size()) {
+          word = set->words.size();
+          return;
+        }
+        rest = set->words[word];
+      }
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef BranchID value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const BranchID *pointer;
+    typedef BranchID reference;
+
+    iterator(const BranchIDSet *s, bool end)
+        : set(s), word(end ? s->words.size() : 0),
+          rest(end || s->words.empty() ? 0 : s->words[0]) {
+      if (!end)
+        advance();
+    }
+
+    BranchID operator*() const {
+      return (set->base + word) * WordBits + llvm::countTrailingZeros(rest);
+    }
+    iterator &operator++() {
+      rest &= rest - 1;
+      advance();
+      return *this;
+    }
+    bool operator==(const iterator &o) const {
+      return word == o.word && rest == o.rest;
+    }
+    bool operator!=(const iterator &o) const { return !(*this == o); }
+  };
+
+  BranchIDSet() {}
+
+  iterator begin() const { return iterator(this, false); }
+  iterator end() const { return iterator(this, true); }
+
+  bool empty() const { return words.empty(); }
+  unsigned size() const {
+    unsigned n = 0;
+    for (Word w : words)
+      n += llvm::countPopulation(w);
+    return n;
+  }
+  void clear() {
+    words.clear();
+    base = 0;
+  }
+
+  size_t count(BranchID id) const {
+    return (getWord(id / WordBits) >> (id % WordBits)) & 1;
+  }
+
+  /// Returns true if \p id was not yet contained.
+  bool insert(BranchID id) {
+    reserveWord(id / WordBits);
+    Word &w = words[id / WordBits - base];
+    Word mask = Word(1) << (id % WordBits);
+    bool inserted = !(w & mask);
+    w |= mask;
+    return inserted;
+  }
+
+  /// Returns the number of removed elements (0 or 1).
+  size_t erase(BranchID id) {
+    unsigned w = id / WordBits;
+    if (w < base || w >= base + words.size())
+      return 0;
+    Word mask = Word(1) << (id % WordBits);
+    bool erased = words[w - base] & mask;
+    words[w - base] &= ~mask;
+    if (erased && (w == base || w + 1 == base + words.size()))
+      shrink();
+    return erased;
+  }
+
+  /// Add the elements of a raw bit vector whose first word has index
+  /// \p wordBase. Used to combine sets with packed rows stored elsewhere.
+  void uniteWords(unsigned wordBase, const uint64_t *w, unsigned n) {
+    if (!n)
+      return;
+    reserveWord(wordBase);
+    reserveWord(wordBase + n - 1);
+    Word *dst = &words[wordBase - base];
+    for (unsigned i = 0; i != n; ++i)
+      dst[i] |= w[i];
+  }
+
+  /// Returns true if the set shares an element with the raw bit vector
+  /// whose first word has index \p wordBase.
+  bool intersectsWords(unsigned wordBase, const uint64_t *w,
+                       unsigned n) const {
+    unsigned lo = std::max(base, wordBase);
+    unsigned hi = std::min<unsigned>(base + words.size(), wordBase + n);
+    for (unsigned i = lo; i < hi; ++i)
+      if (words[i - base] & w[i - wordBase])
+        return true;
+    return false;
+  }
+
+  /// Raw access to the materialized words.
+  unsigned getBaseWord() const { return base; }
+  unsigned getNumWords() const { return words.size(); }
+  const uint64_t *getWords() const { return words.data(); }
+
+  BranchIDSet &operator|=(const BranchIDSet &b) {
+    uniteWords(b.base, b.words.data(), b.words.size());
+    return *this;
+  }
+
+  BranchIDSet &operator&=(const BranchIDSet &b) {
+    for (unsigned i = 0, e = words.size(); i != e; ++i)
+      words[i] &= b.getWord(base + i);
+    shrink();
+    return *this;
+  }
+
+  /// Returns true if both sets share at least one element.
+  bool intersects(const BranchIDSet &b) const {
+    return intersectsWords(b.base, b.words.data(), b.words.size());
+  }
+
+  bool operator==(const BranchIDSet &b) const {
+    return base == b.base && words == b.words;
+  }
+  bool operator!=(const BranchIDSet &b) const { return !(*this == b); }
+
+  /// Number of bytes used by the element storage.
+  size_t getMemoryUsage() const { return words.capacity() * sizeof(Word); }
+};
+
+/// BranchDecisions - A map from branch IDs to one byte each, the
+/// directions a path took at each branch.
+///
+/// Like BranchIDSet only the range between the lowest and the highest
+/// branch with an entry is materialized. An entry may hold any byte,
+/// including 0, so it behaves like the std::map<llvm::Value *, unsigned
+/// char> it replaces.
+///
+/// A hash of the entries is kept up to date on every change. It is the
+/// sum of a hash per (branch, value) pair, so it does not depend on the
+/// order in which the entries were made.
+class BranchDecisions {
+  // the value of the entry plus one, 0 for branches without an entry
+  typedef uint16_t Slot;
+
+  unsigned base = 0;
+  std::vector<Slot> slots;
+  unsigned recorded = 0;
+  uint64_t hash = 0;
+
+  /// splitmix64 finalizer of the pair (id, value).
+  static uint64_t mix(BranchID id, unsigned char value) {
+    uint64_t x = (uint64_t(id) << 8 | value) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  void reserveSlot(BranchID id) {
+    if (slots.empty()) {
+      base = id;
+      slots.push_back(0);
+    } else if (id < base) {
+      slots.insert(slots.begin(), base - id, 0);
+      base = id;
+    } else if (id >= base + slots.size()) {
+      slots.resize(id - base + 1, 0);
+    }
+  }
+
+  Slot getSlot(BranchID id) const {
+    return (id >= base && id < base + slots.size()) ? slots[id - base] : 0;
+  }
+
+public:
+  enum Direction : unsigned char { None = 0, True = 1, False = 2, Both = 3 };
+
+  BranchDecisions() {}
+
+  size_t count(BranchID id) const { return getSlot(id) != 0; }
+
+  /// Returns the value of \p id, or 0 if it has no entry.
+  unsigned char get(BranchID id) const {
+    Slot s = getSlot(id);
+    return s ? s - 1 : 0;
+  }
+
+  /// Set the value of \p id, adding an entry if it has none.
+  void set(BranchID id, unsigned char value) {
+    reserveSlot(id);
+    Slot &s = slots[id - base];
+    if (s)
+      hash -= mix(id, s - 1);
+    else
+      ++recorded;
+    hash += mix(id, value);
+    s = value + 1;
+  }
+
+  /// Add direction(s) \p dirs to the value of \p id.
+  void add(BranchID id, unsigned char dirs) { set(id, get(id) | dirs); }
+
+  /// Record the outcome of a single execution of \p id.
+  void addTaken(BranchID id, bool taken) { add(id, taken ? True : False); }
+
+  /// Remove the entry of \p id. Returns the number of removed entries.
+  size_t erase(BranchID id) {
+    Slot s = getSlot(id);
+    if (!s)
+      return 0;
+    --recorded;
+    hash -= mix(id, s - 1);
+    slots[id - base] = 0;
+    return 1;
+  }
+
+  /// Number of branches with an entry.
+  unsigned size() const { return recorded; }
+  bool empty() const { return recorded == 0; }
+  void clear() {
+    slots.clear();
+    base = 0;
+    recorded = 0;
+    hash = 0;
+  }
+
+  /// Hash of the entries; equal maps have equal hashes.
+  uint64_t getHash() const { return hash; }
+
+  /// Returns the lowest branch ID with an entry not below \p from, or ~0u
+  /// if there is none.
+  BranchID findNext(BranchID from) const {
+    for (unsigned i = std::max(from, base) - base, e = slots.size(); i < e;
+         ++i)
+      if (slots[i])
+        return base + i;
+    return ~0u;
+  }
+
+  /// Calls \p f(id, value) for every entry in ID order.
+  template <typename F> void forEach(F f) const {
+    for (unsigned i = 0, e = slots.size(); i != e; ++i)
+      if (slots[i])
+        f(BranchID(base + i), static_cast<unsigned char>(slots[i] - 1));
+  }
+
+  bool operator==(const BranchDecisions &b) const {
+    if (recorded != b.recorded || hash != b.hash)
+      return false;
+    unsigned lo = std::min(base, b.base);
+    unsigned hi = std::max<unsigned>(base + slots.size(),
+                                     b.base + b.slots.size());
+    for (BranchID id = lo; id < hi; ++id)
+      if (getSlot(id) != b.getSlot(id))
+        return false;
+    return true;
+  }
+  bool operator!=(const BranchDecisions &b) const { return !(*this == b); }
+
+  size_t getMemoryUsage() const { return slots.capacity() * sizeof(Slot); }
+};
+
+/// BranchSetMap - A persistent map from branch IDs to sets of branch IDs.
+///
+/// Copies share their structure: the map itself is an ImmutableMap and the
+/// sets are reference counted, so copying a map (e.g. on every fork) is
+/// O(1). A write copies only the tree path to the modified entry and the
+/// modified set, so the memory used by a family of states is proportional
+/// to how much they diverge rather than to their number.
+class BranchSetMap {
+  struct SharedSet {
+    unsigned refCount = 0;
+    BranchIDSet set;
+
+    SharedSet() {}
+    explicit SharedSet(const BranchIDSet &s) : set(s) {}
+  };
+
+  typedef ImmutableMap<BranchID, ref<SharedSet> > Map;
+  Map elts;
+
+  /// Returns a copy of the set stored for \p key (empty if there is none)
+  /// that is not shared with any other map.
+  ref<SharedSet> copyForWrite(BranchID key) const {
+    const auto *entry = elts.lookup(key);
+    return entry ? new SharedSet(entry->second->set) : new SharedSet();
+  }
+
+public:
+  class iterator {
+    mutable Map::iterator it; // ImmutableTree iterators lack const members
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<BranchID, const BranchIDSet &> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type *pointer;
+    typedef value_type reference;
+
+    explicit iterator(const Map::iterator &i) : it(i) {}
+
+    value_type operator*() const {
+      return value_type(it->first, it->second->set);
+    }
+    iterator &operator++() {
+      ++it;
+      return *this;
+    }
+    bool operator==(const iterator &o) const { return it == o.it; }
+    bool operator!=(const iterator &o) const { return it != o.it; }
+  };
+  typedef iterator const_iterator;
+
+  iterator begin() const { return iterator(elts.begin()); }
+  iterator end() const { return iterator(elts.end()); }
+
+  bool empty() const { return elts.empty(); }
+  size_t size() const { return elts.size(); }
+  void clear() { elts = Map(); }
+
+  /// Returns the set stored for \p key, or null if there is none.
+  const BranchIDSet *lookup(BranchID key) const {
+    const auto *entry = elts.lookup(key);
+    return entry ? &entry->second->set : nullptr;
+  }
+  size_t count(BranchID key) const { return elts.count(key); }
+
+  /// Add \p dep to the set stored for \p key. Returns true if it was not
+  /// contained yet.
+  bool insert(BranchID key, BranchID dep) {
+    const BranchIDSet *current = lookup(key);
+    if (current && current->count(dep))
+      return false;
+    ref<SharedSet> s = copyForWrite(key);
+    s->set.insert(dep);
+    elts = elts.replace(std::make_pair(key, s));
+    return true;
+  }
+
+  /// Add all elements of \p deps to the set stored for \p key.
+  void unite(BranchID key, const BranchIDSet &deps) {
+    ref<SharedSet> s = copyForWrite(key);
+    s->set |= deps;
+    elts = elts.replace(std::make_pair(key, s));
+  }
+
+  /// Replace the set stored for \p key by \p deps.
+  void assign(BranchID key, const BranchIDSet &deps) {
+    elts = elts.replace(std::make_pair(key, ref<SharedSet>(new SharedSet(deps))));
+  }
+
+  size_t erase(BranchID key) {
+    if (!elts.count(key))
+      return 0;
+    elts = elts.remove(key);
+    return 1;
+  }
+
+  bool operator==(const BranchSetMap &b) const {
+    if (size() != b.size())
+      return false;
+    for (auto i = elts.begin(), j = b.elts.begin(), e = elts.end(); i != e;
+         ++i, ++j) {
+      if (i->first != j->first)
+        return false;
+      if (i->second.get() != j->second.get() &&
+          i->second->set != j->second->set)
+        return false;
+    }
+    return true;
+  }
+  bool operator!=(const BranchSetMap &b) const { return !(*this == b); }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BRANCHIDSET_H */
@@ -0,0 +1,188 @@
+//===-- SharedCoverageTable.h -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SHAREDCOVERAGETABLE_H
+#define KLEE_SHAREDCOVERAGETABLE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace klee {
+
+/// SharedCoverageTable - The behaviors (hashes of branch decision maps)
+/// seen by all klee processes exploring the same program.
+///
+/// The table lives in a file mapped into every process, so cooperating
+/// processes on one machine see each other's behaviors immediately. It is
+/// a fixed size open addressing hash set. All updates are single atomic
+/// operations on the mapping, so no locking is needed after the table has
+/// been set up.
+class SharedCoverageTable {
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t numBehaviorSlots;
+  };
+
+  enum : uint32_t { Version = 2 };
+  // Give up looking for a free behavior slot after this many probes.
+  enum : unsigned { MaxProbes = 64 };
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "atomic words must have the size of plain words");
+
+  int fd = -1;
+  void *base = nullptr;
+  size_t size = 0;
+  std::atomic<uint64_t> *slots = nullptr;
+  uint64_t slotMask = 0;
+
+  static const char *getMagic() { return "KLEESHCV"; }
+
+  static size_t getSize(uint64_t behaviorSlots) {
+    return sizeof(Header) + behaviorSlots * sizeof(uint64_t);
+  }
+
+  bool fail(std::string &error, const std::string &what) {
+    error = what;
+    if (errno)
+      error += std::string(": ") + strerror(errno);
+    close();
+    return false;
+  }
+
+public:
+  SharedCoverageTable() = default;
+  SharedCoverageTable(const SharedCoverageTable &) = delete;
+  SharedCoverageTable &operator=(const SharedCoverageTable &) = delete;
+  ~SharedCoverageTable() { close(); }
+
+  /// Map the table stored in \p path, creating it if it does not exist.
+  /// \p key identifies the program (processes exploring different
+  /// programs must not share a table); \p behaviorSlots is rounded up to a
+  /// power of two. Returns false and sets \p error if the file cannot be
+  /// mapped or was created for a different program or size.
+  bool open(const std::string &path, uint64_t key, uint64_t behaviorSlots,
+            std::string &error) {
+    close();
+    uint64_t slotCount = 1;
+    while (slotCount < behaviorSlots)
+      slotCount <<= 1;
+
+    errno = 0;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0)
+      return fail(error, "cannot open \"" + path + "\"");
+    // the first process to get the lock initializes the table
+    if (flock(fd, LOCK_EX) < 0)
+      return fail(error, "cannot lock \"" + path + "\"");
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+      return fail(error, "cannot stat \"" + path + "\"");
+
+    size_t expected = getSize(slotCount);
+    bool create = st.st_size == 0;
+    if (create && ftruncate(fd, expected) < 0)
+      return fail(error, "cannot resize \"" + path + "\"");
+    if (!create && static_cast<size_t>(st.st_size) != expected) {
+      errno = 0;
+      return fail(error, "\"" + path + "\" was created for another program "
+                         "or table size");
+    }
+
+    base = mmap(nullptr, expected, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      base = nullptr;
+      return fail(error, "cannot map \"" + path + "\"");
+    }
+    size = expected;
+
+    Header *header = static_cast<Header *>(base);
+    if (create) {
+      memcpy(header->magic, getMagic(), sizeof(header->magic));
+      header->version = Version;
+      header->key = key;
+      header->numBehaviorSlots = slotCount;
+    } else if (memcmp(header->magic, getMagic(), sizeof(header->magic)) ||
+               header->version != Version || header->key != key ||
+               header->numBehaviorSlots != slotCount) {
+      errno = 0;
+      return fail(error, "\"" + path + "\" was created for another program "
+                         "or table size");
+    }
+    flock(fd, LOCK_UN);
+
+    slotMask = slotCount - 1;
+    slots = reinterpret_cast<std::atomic<uint64_t> *>(header + 1);
+    return true;
+  }
+
+  void close() {
+    if (base)
+      munmap(base, size);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    base = nullptr;
+    size = 0;
+    slots = nullptr;
+  }
+
+  bool isOpen() const { return base != nullptr; }
+
+  /// Record the behavior with hash \p hash. Returns true if no process had
+  /// recorded it before, and also if the table is too full to tell.
+  bool insertBehavior(uint64_t hash) {
+    if (!hash)
+      hash = 1; // 0 marks a free slot
+    for (unsigned probe = 0; probe != MaxProbes; ++probe) {
+      std::atomic<uint64_t> &slot = slots[(hash + probe) & slotMask];
+      uint64_t current = slot.load(std::memory_order_relaxed);
+      if (current == hash)
+        return false;
+      if (current)
+        continue;
+      if (slot.compare_exchange_strong(current, hash,
+                                       std::memory_order_relaxed))
+        return true;
+      if (current == hash)
+        return false;
+    }
+    return true;
+  }
+
+  bool containsBehavior(uint64_t hash) const {
+    if (!hash)
+      hash = 1;
+    for (unsigned probe = 0; probe != MaxProbes; ++probe) {
+      uint64_t current =
+          slots[(hash + probe) & slotMask].load(std::memory_order_relaxed);
+      if (current == hash)
+        return true;
+      if (!current)
+        return false;
+    }
+    return false;
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_SHAREDCOVERAGETABLE_H */
@@ -0,0 +1,188 @@
+//===-- BranchDependenceClosure.h -------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BRANCHDEPENDENCECLOSURE_H
+#define KLEE_BRANCHDEPENDENCECLOSURE_H
+
+#include "klee/Internal/ADT/BranchIDSet.h"
+#include "klee/Internal/Module/BranchDependences.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace klee {
+
+/// BranchDependenceClosure - For every branch, the set of branches it
+/// transitively depends on when walking the dependence graph backwards at
+/// most "reverse limit" branches deep.
+///
+/// Level 1 of a branch are the branches reachable over reverse control and
+/// data dependence edges without passing another branch; level k + 1 adds
+/// level 1 of every branch first reached on level k. A negative limit walks
+/// to the fixpoint, a limit of 0 yields empty closures.
+///
+/// The closures are packed as bit rows into a single word array, so that
+/// combining a closure with a BranchIDSet is a loop over a few machine
+/// words. Rows are computed on first use (or all at once by precompute())
+/// and memoized.
+class BranchDependenceClosure {
+  struct Row {
+    uint32_t baseWord = 0; // index of the first word of the row
+    uint32_t offset = 0;   // position of the row in words
+    uint32_t size = 0;     // number of words
+    bool computed = false;
+  };
+
+  const BranchDependences &deps;
+  int limit;
+
+  mutable std::vector<Row> rows;
+  mutable std::vector<uint64_t> words;
+
+  // level 1 sets, computed on demand
+  mutable std::vector<BranchIDSet> direct;
+  mutable std::vector<bool> directComputed;
+
+  // scratch space for the graph walk
+  mutable std::vector<uint32_t> visited;
+  mutable uint32_t stamp = 0;
+
+  const BranchIDSet &getDirect(BranchID b) const {
+    if (directComputed[b])
+      return direct[b];
+    directComputed[b] = true;
+
+    if (++stamp == 0) {
+      std::fill(visited.begin(), visited.end(), 0);
+      stamp = 1;
+    }
+    BranchIDSet &result = direct[b];
+    std::vector<BranchDependences::InstID> worklist(1, deps.getBranchInst(b));
+    while (!worklist.empty()) {
+      BranchDependences::InstID inst = worklist.back();
+      worklist.pop_back();
+      for (unsigned k = 0; k != 2; ++k) {
+        auto range = deps.getDependences(
+            static_cast<BranchDependences::DependenceKind>(k), inst);
+        for (auto it = range.first; it != range.second; ++it) {
+          if (visited[*it] == stamp)
+            continue;
+          visited[*it] = stamp;
+          BranchID dep = deps.getBranchIDOfInst(*it);
+          if (dep != BranchDependences::InvalidID)
+            result.insert(dep);
+          else
+            worklist.push_back(*it);
+        }
+      }
+    }
+    return result;
+  }
+
+  const Row &getRow(BranchID b) const {
+    Row &row = rows[b];
+    if (row.computed)
+      return row;
+
+    BranchIDSet closure;
+    if (limit != 0) {
+      closure = getDirect(b);
+      BranchIDSet frontier = closure;
+      for (int level = 1; (limit < 0 || level < limit) && !frontier.empty();
+           ++level) {
+        BranchIDSet next;
+        for (BranchID f : frontier)
+          next |= getDirect(f);
+        // only branches first reached on this level are expanded further
+        BranchIDSet added;
+        for (BranchID n : next)
+          if (!closure.count(n))
+            added.insert(n);
+        closure |= added;
+        frontier = std::move(added);
+      }
+    }
+
+    row.computed = true;
+    row.baseWord = closure.getBaseWord();
+    row.offset = words.size();
+    row.size = closure.getNumWords();
+    words.insert(words.end(), closure.getWords(),
+                 closure.getWords() + closure.getNumWords());
+    return row;
+  }
+
+public:
+  BranchDependenceClosure(const BranchDependences &_deps, int _limit)
+      : deps(_deps), limit(_limit), rows(_deps.getNumBranches()),
+        direct(_deps.getNumBranches()),
+        directComputed(_deps.getNumBranches(), false),
+        visited(_deps.getNumInstructions(), 0) {}
+
+  BranchDependenceClosure(const BranchDependenceClosure &) = delete;
+  BranchDependenceClosure &operator=(const BranchDependenceClosure &) = delete;
+
+  int getLimit() const { return limit; }
+
+  /// Change the limit. Closures computed so far are dropped and
+  /// recomputed on demand.
+  void setLimit(int _limit) {
+    if (limit == _limit)
+      return;
+    limit = _limit;
+    std::fill(rows.begin(), rows.end(), Row());
+    words.clear();
+  }
+
+  /// Compute the closures of all branches up front.
+  void precompute() const {
+    for (BranchID b = 0, e = rows.size(); b != e; ++b)
+      getRow(b);
+  }
+
+  /// Returns the closure of \p b as a set.
+  BranchIDSet getClosure(BranchID b) const {
+    BranchIDSet result;
+    unionInto(b, result);
+    return result;
+  }
+
+  /// Add the closure of \p b to \p out.
+  void unionInto(BranchID b, BranchIDSet &out) const {
+    const Row &row = getRow(b);
+    out.uniteWords(row.baseWord, words.data() + row.offset, row.size);
+  }
+
+  /// Returns true if the closure of \p b contains an element of \p s.
+  bool intersects(BranchID b, const BranchIDSet &s) const {
+    const Row &row = getRow(b);
+    return s.intersectsWords(row.baseWord, words.data() + row.offset,
+                             row.size);
+  }
+
+  /// Returns true if \p b (transitively) depends on \p dep.
+  bool dependsOn(BranchID b, BranchID dep) const {
+    const Row &row = getRow(b);
+    unsigned w = dep / 64;
+    if (w < row.baseWord || w >= row.baseWord + row.size)
+      return false;
+    return (words[row.offset + w - row.baseWord] >> (dep % 64)) & 1;
+  }
+
+  /// Number of bytes used by the packed rows.
+  size_t getMemoryUsage() const {
+    return words.capacity() * sizeof(uint64_t) + rows.capacity() * sizeof(Row);
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BRANCHDEPENDENCECLOSURE_H */
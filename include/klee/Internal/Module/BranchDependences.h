@@ -0,0 +1,165 @@
+//===-- BranchDependences.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BRANCHDEPENDENCES_H
+#define KLEE_BRANCHDEPENDENCES_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace klee {
+
+/// BranchDependences - A compact, pointer free summary of the dependence
+/// graph of a module.
+///
+/// Every instruction of the module is given a dense ID in module order
+/// (function, basic block, instruction), and every conditional branch is
+/// additionally given a dense branch ID in the same order. The reverse
+/// control and data dependence edges of the dependence graph are stored
+/// over instruction IDs in compressed sparse row form, which makes the
+/// table cheap to walk.
+class BranchDependences {
+public:
+  typedef uint32_t InstID;
+  typedef uint32_t BranchID;
+
+  enum : uint32_t { InvalidID = ~0u };
+
+  enum DependenceKind { Control = 0, Data = 1 };
+
+  /// Range of instruction IDs a given instruction depends on.
+  typedef std::pair<const InstID *, const InstID *> DepRange;
+
+private:
+  std::vector<llvm::Instruction *> instructions;
+  llvm::DenseMap<const llvm::Value *, InstID> instIDs;
+
+  std::vector<InstID> branches;
+  std::vector<BranchID> branchIDs;
+  unsigned numFunctions = 0;
+
+  // Edges collected before finalize() is called, as (inst, dependsOn).
+  std::vector<std::pair<InstID, InstID> > pending[2];
+
+  // CSR form: the dependences of instruction i are
+  // edges[k][begin[k][i] .. begin[k][i+1]).
+  std::vector<uint32_t> begin[2];
+  std::vector<InstID> edges[2];
+
+public:
+  BranchDependences() {}
+  BranchDependences(const BranchDependences &) = delete;
+  BranchDependences &operator=(const BranchDependences &) = delete;
+
+  /// Assign instruction and branch IDs to all instructions of \p m.
+  /// Any previously recorded dependences are dropped.
+  void numberModule(llvm::Module &m) {
+    instructions.clear();
+    instIDs.clear();
+    branches.clear();
+    branchIDs.clear();
+    for (unsigned k = 0; k != 2; ++k) {
+      pending[k].clear();
+      begin[k].clear();
+      edges[k].clear();
+    }
+    numFunctions = 0;
+
+    for (auto &f : m) {
+      if (!f.isDeclaration())
+        ++numFunctions;
+      for (auto &bb : f) {
+        for (auto &i : bb) {
+          InstID id = instructions.size();
+          instructions.push_back(&i);
+          instIDs[&i] = id;
+          auto *bi = llvm::dyn_cast<llvm::BranchInst>(&i);
+          if (bi && bi->isConditional()) {
+            branchIDs.push_back(branches.size());
+            branches.push_back(id);
+          } else {
+            branchIDs.push_back(InvalidID);
+          }
+        }
+      }
+    }
+  }
+
+  unsigned getNumFunctions() const { return numFunctions; }
+  unsigned getNumInstructions() const { return instructions.size(); }
+  unsigned getNumBranches() const { return branches.size(); }
+  unsigned getNumEdges(DependenceKind kind) const {
+    return edges[kind].size();
+  }
+
+  llvm::Instruction *getInstruction(InstID id) const {
+    return instructions[id];
+  }
+
+  InstID getInstID(const llvm::Value *v) const {
+    auto it = instIDs.find(v);
+    return it == instIDs.end() ? InvalidID : it->second;
+  }
+
+  /// Returns the branch ID of \p v, or InvalidID if \p v is not a
+  /// conditional branch of the numbered module.
+  BranchID getBranchID(const llvm::Value *v) const {
+    InstID id = getInstID(v);
+    return id == InvalidID ? InvalidID : branchIDs[id];
+  }
+
+  BranchID getBranchIDOfInst(InstID id) const { return branchIDs[id]; }
+  InstID getBranchInst(BranchID id) const { return branches[id]; }
+  llvm::Instruction *getBranch(BranchID id) const {
+    return instructions[branches[id]];
+  }
+
+  /// Record that \p inst depends on \p dependsOn.
+  void addDependence(DependenceKind kind, InstID inst, InstID dependsOn) {
+    pending[kind].emplace_back(inst, dependsOn);
+  }
+
+  /// Move the recorded dependences into their final (CSR) form. Duplicate
+  /// edges are removed.
+  void finalize() {
+    for (unsigned k = 0; k != 2; ++k) {
+      auto &p = pending[k];
+      std::sort(p.begin(), p.end());
+      p.erase(std::unique(p.begin(), p.end()), p.end());
+
+      begin[k].assign(instructions.size() + 1, 0);
+      edges[k].clear();
+      edges[k].reserve(p.size());
+      for (const auto &e : p) {
+        ++begin[k][e.first + 1];
+        edges[k].push_back(e.second);
+      }
+      for (unsigned i = 0, e = instructions.size(); i != e; ++i)
+        begin[k][i + 1] += begin[k][i];
+
+      std::vector<std::pair<InstID, InstID> >().swap(p);
+    }
+  }
+
+  /// Returns the instructions \p inst directly depends on.
+  DepRange getDependences(DependenceKind kind, InstID inst) const {
+    const InstID *base = edges[kind].data();
+    return DepRange(base + begin[kind][inst], base + begin[kind][inst + 1]);
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BRANCHDEPENDENCES_H */
@@ -0,0 +1,328 @@
+//===-- BranchValueMaps.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BRANCHVALUEMAPS_H
+#define KLEE_BRANCHVALUEMAPS_H
+
+#include "klee/Internal/ADT/BranchIDSet.h"
+#include "klee/Internal/Module/BranchDependences.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Value;
+}
+
+namespace klee {
+
+/// BranchNumbering - The BranchDependences table whose branch IDs key the
+/// per-state branch containers. It translates the llvm::Value keys of
+/// BranchDecisionMap and BranchDependenceMap, so it must be set before
+/// they are used with such keys.
+///
+/// Values the table did not number, e.g. the branches of the libraries
+/// linked in after numbering, get fresh IDs after those of the table the
+/// first time they are stored.
+class BranchNumbering {
+  struct Numbering {
+    const BranchDependences *deps = nullptr;
+    llvm::DenseMap<const llvm::Value *, BranchID> freshIDs;
+    std::vector<llvm::Value *> fresh;
+  };
+
+  static Numbering &current() {
+    static Numbering numbering;
+    return numbering;
+  }
+
+public:
+  static void set(const BranchDependences *deps) {
+    Numbering &n = current();
+    n.deps = deps;
+    n.freshIDs.clear();
+    n.fresh.clear();
+  }
+  static const BranchDependences *get() { return current().deps; }
+
+  /// Returns the branch ID of \p v, or InvalidID if it has none yet.
+  static BranchID lookup(const llvm::Value *v) {
+    const Numbering &n = current();
+    assert(n.deps && "no branch numbering set");
+    BranchID id = n.deps->getBranchID(v);
+    if (id != BranchDependences::InvalidID)
+      return id;
+    auto it = n.freshIDs.find(v);
+    return it == n.freshIDs.end() ? BranchDependences::InvalidID
+                                  : it->second;
+  }
+
+  /// Returns the branch ID of \p v, giving it a fresh one if it has none.
+  static BranchID getID(const llvm::Value *v) {
+    BranchID id = lookup(v);
+    if (id != BranchDependences::InvalidID)
+      return id;
+    Numbering &n = current();
+    id = n.deps->getNumBranches() + n.fresh.size();
+    n.freshIDs[v] = id;
+    n.fresh.push_back(const_cast<llvm::Value *>(v));
+    return id;
+  }
+
+  static llvm::Value *getBranch(BranchID id) {
+    const Numbering &n = current();
+    assert(n.deps && "no branch numbering set");
+    unsigned numbered = n.deps->getNumBranches();
+    return id < numbered ? n.deps->getBranch(id) : n.fresh[id - numbered];
+  }
+};
+
+/// Helper for iterators whose values are computed: operator-> returns
+/// this holder, which keeps the value alive for the member access.
+template <class T> struct ArrowProxy {
+  T value;
+  const T *operator->() const { return &value; }
+};
+
+/// BranchDecisionMap - BranchDecisions that can also be used like the
+/// std::map<llvm::Value *, unsigned char> it replaces in ExecutionState.
+///
+/// Keys are translated with BranchNumbering. As with std::map, operator[]
+/// adds an entry with value 0 for a key that has none.
+class BranchDecisionMap : public BranchDecisions {
+public:
+  /// Stands for the mapped value of a key.
+  class reference {
+    BranchDecisions &decisions;
+    BranchID id;
+
+  public:
+    reference(BranchDecisions &d, BranchID _id) : decisions(d), id(_id) {}
+
+    operator unsigned char() const { return decisions.get(id); }
+    reference &operator=(unsigned char value) {
+      decisions.set(id, value);
+      return *this;
+    }
+    reference &operator|=(unsigned char dirs) {
+      decisions.add(id, dirs);
+      return *this;
+    }
+  };
+
+  class const_iterator {
+    const BranchDecisions *decisions;
+    BranchID id;
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<llvm::Value *, unsigned char> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef ArrowProxy<value_type> pointer;
+    typedef value_type reference;
+
+    const_iterator(const BranchDecisions *d, BranchID _id)
+        : decisions(d), id(_id) {}
+
+    value_type operator*() const {
+      return value_type(BranchNumbering::getBranch(id), decisions->get(id));
+    }
+    pointer operator->() const { return pointer{**this}; }
+    const_iterator &operator++() {
+      id = decisions->findNext(id + 1);
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const { return id == o.id; }
+    bool operator!=(const const_iterator &o) const { return id != o.id; }
+  };
+  typedef const_iterator iterator;
+
+  using BranchDecisions::count;
+  using BranchDecisions::erase;
+
+  reference operator[](const llvm::Value *v) {
+    BranchID id = BranchNumbering::getID(v);
+    if (!count(id))
+      set(id, 0);
+    return reference(*this, id);
+  }
+
+  size_t count(const llvm::Value *v) const {
+    BranchID id = BranchNumbering::lookup(v);
+    return id != BranchDependences::InvalidID && count(id);
+  }
+
+  size_t erase(const llvm::Value *v) {
+    BranchID id = BranchNumbering::lookup(v);
+    return id != BranchDependences::InvalidID ? erase(id) : 0;
+  }
+
+  const_iterator begin() const { return const_iterator(this, findNext(0)); }
+  const_iterator end() const { return const_iterator(this, ~0u); }
+  const_iterator find(const llvm::Value *v) const {
+    return count(v) ? const_iterator(this, BranchNumbering::lookup(v)) : end();
+  }
+};
+
+/// BranchValueSet - A read-only view of a BranchIDSet as a set of
+/// llvm::Value pointers, as the std::set<llvm::Value *> it replaces.
+class BranchValueSet {
+  const BranchIDSet *set;
+
+  const BranchIDSet &get() const {
+    static const BranchIDSet empty;
+    return set ? *set : empty;
+  }
+
+public:
+  class const_iterator {
+    BranchIDSet::iterator it;
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef llvm::Value *value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef llvm::Value *const *pointer;
+    typedef llvm::Value *reference;
+
+    explicit const_iterator(const BranchIDSet::iterator &i) : it(i) {}
+
+    llvm::Value *operator*() const { return BranchNumbering::getBranch(*it); }
+    const_iterator &operator++() {
+      ++it;
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const { return it == o.it; }
+    bool operator!=(const const_iterator &o) const { return it != o.it; }
+  };
+  typedef const_iterator iterator;
+
+  /// \p s may be null for the empty set.
+  explicit BranchValueSet(const BranchIDSet *s) : set(s) {}
+
+  const_iterator begin() const { return const_iterator(get().begin()); }
+  const_iterator end() const { return const_iterator(get().end()); }
+  bool empty() const { return !set || set->empty(); }
+  size_t size() const { return set ? set->size() : 0; }
+  size_t count(const llvm::Value *v) const {
+    BranchID id = BranchNumbering::lookup(v);
+    return set && id != BranchDependences::InvalidID && set->count(id);
+  }
+};
+
+/// BranchDependenceMap - A BranchSetMap that can also be used like the
+/// std::map<llvm::Value *, std::set<llvm::Value *> > it replaces in
+/// ExecutionState. Keys and elements are translated with BranchNumbering.
+///
+/// operator[] returns a proxy for the set of a key; writes through it
+/// copy the set on write like insert() does, so they never affect other
+/// states sharing it. As with std::map, operator[] adds an empty set for
+/// a key that has none.
+class BranchDependenceMap : public BranchSetMap {
+public:
+  class reference {
+    BranchSetMap &map;
+    BranchID key;
+
+    // looked up on every access, a write replaces the set
+    BranchValueSet get() const { return BranchValueSet(map.lookup(key)); }
+
+  public:
+    reference(BranchSetMap &m, BranchID k) : map(m), key(k) {}
+
+    BranchValueSet::const_iterator begin() const { return get().begin(); }
+    BranchValueSet::const_iterator end() const { return get().end(); }
+    bool empty() const { return get().empty(); }
+    size_t size() const { return get().size(); }
+    size_t count(const llvm::Value *v) const { return get().count(v); }
+
+    /// Returns true if \p v was not contained yet.
+    bool insert(const llvm::Value *v) {
+      return map.insert(key, BranchNumbering::getID(v));
+    }
+
+    template <class InputIt> void insert(InputIt first, InputIt last) {
+      for (; first != last; ++first)
+        insert(*first);
+    }
+
+    void clear() { map.assign(key, BranchIDSet()); }
+  };
+
+  class const_iterator {
+    BranchSetMap::iterator it;
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<llvm::Value *, BranchValueSet> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef ArrowProxy<value_type> pointer;
+    typedef value_type reference;
+
+    explicit const_iterator(const BranchSetMap::iterator &i) : it(i) {}
+
+    value_type operator*() const {
+      auto entry = *it;
+      return value_type(BranchNumbering::getBranch(entry.first),
+                        BranchValueSet(&entry.second));
+    }
+    pointer operator->() const { return pointer{**this}; }
+    const_iterator &operator++() {
+      ++it;
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const { return it == o.it; }
+    bool operator!=(const const_iterator &o) const { return it != o.it; }
+  };
+  typedef const_iterator iterator;
+
+  using BranchSetMap::count;
+  using BranchSetMap::erase;
+
+  reference operator[](const llvm::Value *v) {
+    BranchID id = BranchNumbering::getID(v);
+    if (!count(id))
+      assign(id, BranchIDSet());
+    return reference(*this, id);
+  }
+
+  size_t count(const llvm::Value *v) const {
+    BranchID id = BranchNumbering::lookup(v);
+    return id != BranchDependences::InvalidID && count(id);
+  }
+
+  size_t erase(const llvm::Value *v) {
+    BranchID id = BranchNumbering::lookup(v);
+    return id != BranchDependences::InvalidID ? erase(id) : 0;
+  }
+
+  /// Iterate by llvm::Value; iterate the BranchSetMap base for IDs.
+  const_iterator begin() const {
+    return const_iterator(BranchSetMap::begin());
+  }
+  const_iterator end() const { return const_iterator(BranchSetMap::end()); }
+  const_iterator find(const llvm::Value *v) const {
+    if (!count(v))
+      return end();
+    auto it = BranchSetMap::begin(), ie = BranchSetMap::end();
+    BranchID id = BranchNumbering::lookup(v);
+    while (it != ie && (*it).first != id)
+      ++it;
+    return const_iterator(it);
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_BRANCHVALUEMAPS_H */
@@ -0,0 +1,104 @@
+//===-- ErrorTargets.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_ERRORTARGETS_H
+#define KLEE_ERRORTARGETS_H
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Path.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+/// ErrorTargets - The --error-location targets and whether an error has
+/// been found at each of them.
+///
+/// A target is a source file, optionally with a line. It matches the
+/// source path of a location, which includes the compilation directory,
+/// if it is that path or a suffix of it that starts at a path component.
+class ErrorTargets {
+public:
+  struct Target {
+    std::string file;
+    unsigned line; // 0 = any line of the file
+    bool hit;
+  };
+
+private:
+  std::vector<Target> targets;
+
+  /// Whether \p target names the file at \p path: it is the path itself
+  /// or a suffix of it that starts at a path component.
+  static bool matchesFile(llvm::StringRef path, llvm::StringRef target) {
+    llvm::SmallString<128> t(target);
+    llvm::sys::path::remove_dots(t);
+    if (path == t)
+      return true;
+    return path.endswith(t) && path.drop_back(t.size()).endswith("/");
+  }
+
+public:
+  ErrorTargets() {}
+
+  ErrorTargets(const ErrorTargets &) = delete;
+  ErrorTargets &operator=(const ErrorTargets &) = delete;
+
+  /// Add a target for every line in \p locations (file -> lines; no lines
+  /// means any line of the file), as parsed from --error-location.
+  void
+  addTargets(const std::map<std::string, std::vector<unsigned> > &locations) {
+    for (const auto &loc : locations) {
+      if (loc.second.empty())
+        targets.push_back({loc.first, 0, false});
+      for (unsigned line : loc.second)
+        targets.push_back({loc.first, line, false});
+    }
+  }
+
+  unsigned getNumTargets() const { return targets.size(); }
+  const Target &getTarget(unsigned t) const { return targets[t]; }
+
+  /// Append to \p result the targets at line \p line of the source file
+  /// \p path, which includes the compilation directory.
+  void getTargetsAt(llvm::StringRef path, unsigned line,
+                    std::vector<unsigned> &result) const {
+    for (unsigned t = 0, e = targets.size(); t != e; ++t)
+      if ((!targets[t].line || targets[t].line == line) &&
+          matchesFile(path, targets[t].file))
+        result.push_back(t);
+  }
+
+  /// Record that an error was found at target \p t. Returns false if one
+  /// had been found there before.
+  bool markHit(unsigned t) {
+    if (targets[t].hit)
+      return false;
+    targets[t].hit = true;
+    return true;
+  }
+
+  bool isHit(unsigned t) const { return targets[t].hit; }
+
+  /// Number of targets at which no error has been found yet.
+  unsigned getNumRemainingTargets() const {
+    unsigned n = 0;
+    for (const auto &t : targets)
+      if (!t.hit)
+        ++n;
+    return n;
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_ERRORTARGETS_H */
@@ -0,0 +1,57 @@
+//===-- ModuleKey.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_MODULEKEY_H
+#define KLEE_MODULEKEY_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+
+#include <cstdint>
+
+namespace klee {
+
+/// Returns a key identifying the final module \p m by its functions and
+/// their sizes, so that data shared between processes (shared coverage) is
+/// only used with the program it was made for.
+///
+/// The key is part of files read by other processes, so it is computed
+/// with MD5 rather than with llvm::hash_combine, which may differ between
+/// executions.
+inline uint64_t getModuleKey(const llvm::Module &m) {
+  llvm::MD5 hash;
+  auto update = [&hash](uint64_t value) {
+    uint8_t bytes[8];
+    for (unsigned i = 0; i != 8; ++i)
+      bytes[i] = value >> (8 * i);
+    hash.update(llvm::ArrayRef<uint8_t>(bytes));
+  };
+
+  update(m.size());
+  for (const auto &f : m) {
+    uint64_t size = 0;
+    for (const auto &bb : f)
+      size += bb.size();
+    update(f.getName().size());
+    hash.update(f.getName());
+    update(size);
+  }
+
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  uint64_t key = 0;
+  for (unsigned i = 0; i != 8; ++i)
+    key = (key << 8) | result[i];
+  return key;
+}
+
+} // End klee namespace
+
+#endif /* KLEE_MODULEKEY_H */
@@ -0,0 +1,159 @@
+//===-- CanonicalCachingSolver.h --------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CANONICALCACHINGSOLVER_H
+#define KLEE_CANONICALCACHINGSOLVER_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/QueryCanonicalizer.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace klee {
+
+/// CanonicalCachingSolver - Caches the answers of the underlying solver in
+/// memory, keyed by the canonical form of the query (see
+/// QueryCanonicalizer).
+///
+/// Queries that differ only in the names of their arrays, the order of
+/// their constraints or the operand order of commutative operations
+/// share an entry, which the caching and counterexample caching solvers
+/// keyed by the expressions themselves miss. Entries are hashed with the
+/// canonical hash and compared by the whole form, so a hash collision
+/// never returns a wrong answer. Initial values are cached with the
+/// objects asked for, which keeps them positional. Only successful
+/// answers are cached.
+///
+/// Only kleaver offers it (--use-canonical-cache); klee builds its solver
+/// chain in the executor, which does not use it.
+class CanonicalCachingSolver : public SolverImpl {
+  struct Key {
+    uint64_t hash;
+    std::string form;
+    bool operator==(const Key &o) const {
+      return hash == o.hash && form == o.form;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &k) const { return k.hash; }
+  };
+
+  struct InitialValues {
+    std::vector<std::vector<unsigned char> > values;
+    bool hasSolution;
+  };
+
+  Solver *solver;
+  QueryCanonicalizer canonicalizer;
+  std::unordered_map<Key, Solver::Validity, KeyHash> validityCache;
+  std::unordered_map<Key, bool, KeyHash> truthCache;
+  std::unordered_map<Key, ref<Expr>, KeyHash> valueCache;
+  std::unordered_map<Key, InitialValues, KeyHash> initialValuesCache;
+  uint64_t hits = 0, misses = 0;
+
+  Key getKey(const Query &query,
+             const std::vector<const Array *> *objects = nullptr) {
+    canonicalizer.canonicalize(query, objects);
+    return Key{canonicalizer.getHash(), canonicalizer.getForm()};
+  }
+
+  template <class Map>
+  const typename Map::mapped_type *lookup(const Map &map, const Key &key) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+      ++misses;
+      return nullptr;
+    }
+    ++hits;
+    return &it->second;
+  }
+
+public:
+  explicit CanonicalCachingSolver(Solver *_solver) : solver(_solver) {}
+  ~CanonicalCachingSolver() { delete solver; }
+
+  uint64_t getNumHits() const { return hits; }
+  uint64_t getNumMisses() const { return misses; }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    Key key = getKey(query);
+    if (auto *cached = lookup(validityCache, key)) {
+      result = *cached;
+      return true;
+    }
+    if (!solver->impl->computeValidity(query, result))
+      return false;
+    validityCache.emplace(std::move(key), result);
+    return true;
+  }
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    Key key = getKey(query);
+    if (auto *cached = lookup(truthCache, key)) {
+      isValid = *cached;
+      return true;
+    }
+    if (!solver->impl->computeTruth(query, isValid))
+      return false;
+    truthCache.emplace(std::move(key), isValid);
+    return true;
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    Key key = getKey(query);
+    if (auto *cached = lookup(valueCache, key)) {
+      result = *cached;
+      return true;
+    }
+    if (!solver->impl->computeValue(query, result))
+      return false;
+    valueCache.emplace(std::move(key), result);
+    return true;
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    Key key = getKey(query, &objects);
+    if (auto *cached = lookup(initialValuesCache, key)) {
+      values = cached->values;
+      hasSolution = cached->hasSolution;
+      return true;
+    }
+    if (!solver->impl->computeInitialValues(query, objects, values,
+                                            hasSolution))
+      return false;
+    initialValuesCache.emplace(std::move(key),
+                               InitialValues{values, hasSolution});
+    return true;
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(time::Span timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_CANONICALCACHINGSOLVER_H */
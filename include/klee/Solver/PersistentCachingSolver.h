@@ -0,0 +1,143 @@
+//===-- PersistentCachingSolver.h -------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PERSISTENTCACHINGSOLVER_H
+#define KLEE_PERSISTENTCACHINGSOLVER_H
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/PersistentQueryCache.h"
+#include "klee/Solver/QueryCanonicalizer.h"
+#include "klee/Solver/QueryResultCodec.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <string>
+#include <vector>
+
+namespace klee {
+
+/// PersistentCachingSolver - Answers queries from a PersistentQueryCache
+/// and stores the answers of the underlying solver in it.
+///
+/// A query is identified by the digest of its canonical form (see
+/// QueryCanonicalizer), which is independent of addresses, array names
+/// and the run. Only successful answers are stored. The wrapper is meant
+/// to sit right above the core solver, so only queries missed by the
+/// in-memory caches pay for canonicalization. The cache counts the hits
+/// and misses.
+///
+/// Only kleaver offers it (--persistent-query-cache); klee builds its
+/// solver chain in the executor, which does not use it.
+class PersistentCachingSolver : public SolverImpl {
+  Solver *solver;
+  PersistentQueryCache &cache;
+  QueryCanonicalizer canonicalizer;
+
+  typedef PersistentQueryCache::Key Key;
+
+  Key getKey(const Query &query,
+             const std::vector<const Array *> *objects = nullptr) {
+    canonicalizer.canonicalize(query, objects);
+    auto digest = canonicalizer.getDigest();
+    Key key;
+    key.lo = digest.first;
+    key.hi = digest.second;
+    return key;
+  }
+
+public:
+  PersistentCachingSolver(Solver *_solver, PersistentQueryCache &_cache)
+      : solver(_solver), cache(_cache) {}
+  ~PersistentCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    Key key = getKey(query);
+    std::string data;
+    if (cache.lookup(key, PersistentQueryCache::Validity, data) &&
+        QueryResultCodec::decodeValidity(data, result))
+      return true;
+    if (!solver->impl->computeValidity(query, result))
+      return false;
+    data.clear();
+    QueryResultCodec::encodeValidity(result, data);
+    cache.insert(key, PersistentQueryCache::Validity, data);
+    return true;
+  }
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    Key key = getKey(query);
+    std::string data;
+    if (cache.lookup(key, PersistentQueryCache::Truth, data) &&
+        QueryResultCodec::decodeTruth(data, isValid))
+      return true;
+    if (!solver->impl->computeTruth(query, isValid))
+      return false;
+    data.clear();
+    QueryResultCodec::encodeTruth(isValid, data);
+    cache.insert(key, PersistentQueryCache::Truth, data);
+    return true;
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    Key key = getKey(query);
+    std::string data;
+    if (cache.lookup(key, PersistentQueryCache::Value, data) &&
+        QueryResultCodec::decodeValue(data, result))
+      return true;
+    if (!solver->impl->computeValue(query, result))
+      return false;
+    data.clear();
+    if (QueryResultCodec::encodeValue(result, data))
+      cache.insert(key, PersistentQueryCache::Value, data);
+    return true;
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    Key key = getKey(query, &objects);
+    std::string data;
+    if (cache.lookup(key, PersistentQueryCache::InitialValues, data) &&
+        QueryResultCodec::decodeInitialValues(data, objects.size(), values,
+                                              hasSolution))
+      return true;
+    if (!solver->impl->computeInitialValues(query, objects, values,
+                                            hasSolution))
+      return false;
+    data.clear();
+    QueryResultCodec::encodeInitialValues(values, hasSolution, data);
+    cache.insert(key, PersistentQueryCache::InitialValues, data);
+    return true;
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(time::Span timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+/// Create a solver answering queries from \p cache (which must be open)
+/// before asking \p s, and storing the answers of \p s in it.
+inline Solver *createPersistentCachingSolver(Solver *s,
+                                             PersistentQueryCache &cache) {
+  return new Solver(new PersistentCachingSolver(s, cache));
+}
+
+} // End klee namespace
+
+#endif /* KLEE_PERSISTENTCACHINGSOLVER_H */
@@ -0,0 +1,253 @@
+//===-- PersistentQueryCache.h ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PERSISTENTQUERYCACHE_H
+#define KLEE_PERSISTENTQUERYCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace klee {
+
+/// PersistentQueryCache - Solver results stored in a file, so that they
+/// survive the run and can be shared by runs on the same machine, also
+/// while they execute.
+///
+/// The file is append-only: a header followed by records of a 128 bit
+/// query key, the kind of result, the encoded result and a checksum. It
+/// is mapped read-only for lookups; records are appended with write(2)
+/// while holding an exclusive lock. A record torn by a crash fails its
+/// checksum, is ignored by readers and overwritten by the next writer, so
+/// the file stays usable whatever happens to the processes using it. The
+/// file never shrinks, so a mapping never extends past its end.
+class PersistentQueryCache {
+public:
+  struct Key {
+    uint64_t lo = 0, hi = 0;
+    bool operator==(const Key &o) const { return lo == o.lo && hi == o.hi; }
+  };
+
+  /// What a record holds; part of the lookup key.
+  enum Kind : uint32_t { Validity = 1, Truth = 2, Value = 3, InitialValues = 4 };
+
+private:
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+  };
+
+  struct RecordHeader {
+    Key key;
+    uint32_t kind;
+    uint32_t size;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &k) const { return k.lo ^ (k.hi * 31); }
+  };
+
+  struct Entry {
+    Kind kind;
+    uint64_t offset; // of the payload
+    uint32_t size;
+  };
+
+  enum : uint32_t { Version = 1 };
+
+  int fd = -1;
+  const char *map = nullptr;
+  size_t mapSize = 0;
+  uint64_t scanned = 0; // end of the last valid record seen
+  std::unordered_multimap<Key, Entry, KeyHash> index;
+
+  uint64_t hits = 0, misses = 0, stores = 0;
+
+  static const char *getMagic() { return "KLEEQCCH"; }
+
+  static uint32_t checksum(const char *data, size_t n, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i != n; ++i)
+      h = (h ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    return h;
+  }
+
+  bool fail(std::string &error, const std::string &what) {
+    error = what;
+    if (errno)
+      error += std::string(": ") + strerror(errno);
+    close();
+    return false;
+  }
+
+  /// Map the file as far as it currently extends and index the records
+  /// appended since the last scan.
+  void refresh() {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<uint64_t>(st.st_size) <= scanned)
+      return;
+    size_t size = st.st_size;
+    if (size != mapSize) {
+      // keep the old mapping, which the index refers to, if this fails
+      void *m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (m == MAP_FAILED)
+        return;
+      if (map)
+        munmap(const_cast<char *>(map), mapSize);
+      map = static_cast<const char *>(m);
+      mapSize = size;
+    }
+
+    while (scanned + sizeof(RecordHeader) + sizeof(uint32_t) <= mapSize) {
+      RecordHeader rh;
+      memcpy(&rh, map + scanned, sizeof(rh));
+      uint64_t payload = scanned + sizeof(rh);
+      if (rh.size > mapSize - payload - sizeof(uint32_t))
+        break; // not completely written (yet)
+      uint32_t stored;
+      memcpy(&stored, map + payload + rh.size, sizeof(stored));
+      if (stored != checksum(map + payload, rh.size,
+                             checksum(map + scanned, sizeof(rh))))
+        break; // torn by a crash
+      index.emplace(rh.key, Entry{static_cast<Kind>(rh.kind), payload, rh.size});
+      scanned = payload + rh.size + sizeof(uint32_t);
+    }
+  }
+
+  const Entry *find(const Key &key, Kind kind) const {
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+      if (it->second.kind == kind)
+        return &it->second;
+    return nullptr;
+  }
+
+public:
+  PersistentQueryCache() = default;
+  PersistentQueryCache(const PersistentQueryCache &) = delete;
+  PersistentQueryCache &operator=(const PersistentQueryCache &) = delete;
+  ~PersistentQueryCache() { close(); }
+
+  /// Open (or create) the cache stored in \p path. Returns false and sets
+  /// \p error if it cannot be opened or is not a query cache.
+  bool open(const std::string &path, std::string &error) {
+    close();
+    errno = 0;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0)
+      return fail(error, "cannot open \"" + path + "\"");
+    if (flock(fd, LOCK_EX) < 0)
+      return fail(error, "cannot lock \"" + path + "\"");
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+      return fail(error, "cannot stat \"" + path + "\"");
+
+    FileHeader fh;
+    if (st.st_size == 0) {
+      memcpy(fh.magic, getMagic(), sizeof(fh.magic));
+      fh.version = Version;
+      fh.reserved = 0;
+      if (pwrite(fd, &fh, sizeof(fh), 0) != sizeof(fh))
+        return fail(error, "cannot write \"" + path + "\"");
+    } else if (pread(fd, &fh, sizeof(fh), 0) != sizeof(fh) ||
+               memcmp(fh.magic, getMagic(), sizeof(fh.magic)) ||
+               fh.version != Version) {
+      errno = 0;
+      return fail(error, "\"" + path + "\" is not a query cache of this "
+                         "version");
+    }
+    flock(fd, LOCK_UN);
+
+    scanned = sizeof(FileHeader);
+    refresh();
+    return true;
+  }
+
+  void close() {
+    if (map)
+      munmap(const_cast<char *>(map), mapSize);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    map = nullptr;
+    mapSize = 0;
+    scanned = 0;
+    index.clear();
+  }
+
+  bool isOpen() const { return fd >= 0; }
+
+  /// Look up the result of \p kind stored for \p key, including results
+  /// appended by other processes since the last lookup.
+  bool lookup(const Key &key, Kind kind, std::string &result) {
+    const Entry *e = find(key, kind);
+    if (!e) {
+      refresh();
+      e = find(key, kind);
+    }
+    if (!e) {
+      ++misses;
+      return false;
+    }
+    ++hits;
+    result.assign(map + e->offset, e->size);
+    return true;
+  }
+
+  /// Append \p result of \p kind for \p key.
+  bool insert(const Key &key, Kind kind, llvm::StringRef result) {
+    if (flock(fd, LOCK_EX) < 0)
+      return false;
+    refresh();
+    if (find(key, kind)) {
+      flock(fd, LOCK_UN);
+      return true;
+    }
+
+    std::string record(sizeof(RecordHeader), '\0');
+    RecordHeader rh;
+    rh.key = key;
+    rh.kind = kind;
+    rh.size = result.size();
+    memcpy(&record[0], &rh, sizeof(rh));
+    record.append(result.data(), result.size());
+    uint32_t sum = checksum(result.data(), result.size(),
+                            checksum(record.data(), sizeof(rh)));
+    record.append(reinterpret_cast<const char *>(&sum), sizeof(sum));
+
+    // append after the last valid record, overwriting a torn one
+    bool ok = pwrite(fd, record.data(), record.size(), scanned) ==
+              static_cast<ssize_t>(record.size());
+    flock(fd, LOCK_UN);
+    if (ok) {
+      ++stores;
+      refresh();
+    }
+    return ok;
+  }
+
+  size_t size() const { return index.size(); }
+  uint64_t getNumHits() const { return hits; }
+  uint64_t getNumMisses() const { return misses; }
+  uint64_t getNumStores() const { return stores; }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_PERSISTENTQUERYCACHE_H */
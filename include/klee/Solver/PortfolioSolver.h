@@ -0,0 +1,324 @@
+//===-- PortfolioSolver.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PORTFOLIOSOLVER_H
+#define KLEE_PORTFOLIOSOLVER_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/Solver/QueryResultCodec.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace klee {
+
+/// PortfolioSolver - Races several core solvers on every query and takes
+/// the first answer.
+///
+/// Each backend runs in a forked process, which gets a copy of the query
+/// for free and can be killed as soon as another backend has answered;
+/// none of the core solvers can be interrupted safely within the process.
+/// The answer comes back encoded (see QueryResultCodec) through a pipe.
+/// A backend that fails or times out does not end the race; the query
+/// fails only if all backends fail.
+///
+/// Wins, failures and the time to the winning answer are recorded per
+/// backend, to find out which backend is worth preferring.
+///
+/// Forking copies only the calling thread, so the portfolio must not be
+/// used while other threads of the process may hold locks (e.g. of the
+/// allocator) or run solvers: a child could block on them forever.
+///
+/// Only kleaver offers it (--solver-portfolio); klee builds its solver
+/// chain in the executor, which does not use it.
+class PortfolioSolver : public SolverImpl {
+public:
+  struct Backend {
+    std::string name;
+    Solver *solver;
+    uint64_t wins = 0;
+    uint64_t failures = 0;
+    /// Sum of the times from starting the race to the answers it won.
+    time::Span winTime;
+
+    Backend(std::string _name, Solver *_solver)
+        : name(std::move(_name)), solver(_solver) {}
+  };
+
+private:
+  struct Racer {
+    pid_t pid = -1;
+    int fd = -1;
+    std::string message;
+  };
+
+  std::vector<Backend> backends;
+  SolverRunStatus status = SOLVER_RUN_STATUS_FAILURE;
+
+  static bool writeAll(int fd, const std::string &data) {
+    for (size_t done = 0; done != data.size();) {
+      ssize_t n = write(fd, data.data() + done, data.size() - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      done += n;
+    }
+    return true;
+  }
+
+  /// Run \p run(solver, result) with every backend and return the first
+  /// successful \p result. \p run encodes its answer into result.
+  template <class Run> bool race(Run run, std::string &result) {
+    if (backends.size() == 1) {
+      Backend &b = backends.front();
+      time::Point start = time::getWallTime();
+      bool success = run(b.solver, result);
+      status = b.solver->impl->getOperationStatusCode();
+      if (success) {
+        ++b.wins;
+        b.winTime += time::getWallTime() - start;
+      } else {
+        ++b.failures;
+      }
+      return success;
+    }
+
+    time::Point start = time::getWallTime();
+    std::vector<Racer> racers(backends.size());
+    status = SOLVER_RUN_STATUS_FORK_FAILED;
+    for (unsigned i = 0; i != backends.size(); ++i) {
+      int fds[2];
+      if (pipe(fds) < 0)
+        continue;
+      pid_t pid = fork();
+      if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        continue;
+      }
+      if (pid == 0) {
+        ::close(fds[0]);
+        std::string answer;
+        bool success = run(backends[i].solver, answer);
+        std::string message(1, static_cast<char>(success));
+        message.push_back(static_cast<char>(
+            backends[i].solver->impl->getOperationStatusCode()));
+        message += answer;
+        _exit(writeAll(fds[1], message) ? 0 : 1);
+      }
+      ::close(fds[1]);
+      racers[i].pid = pid;
+      racers[i].fd = fds[0];
+    }
+
+    // read the answers as they come in; a message is complete at EOF
+    int winner = -1;
+    unsigned running = 0;
+    for (const Racer &r : racers)
+      running += r.fd >= 0;
+    if (running)
+      status = SOLVER_RUN_STATUS_FAILURE;
+    while (running && winner < 0) {
+      std::vector<pollfd> fds;
+      std::vector<unsigned> owners;
+      for (unsigned i = 0; i != racers.size(); ++i) {
+        if (racers[i].fd < 0)
+          continue;
+        fds.push_back(pollfd{racers[i].fd, POLLIN, 0});
+        owners.push_back(i);
+      }
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        status = SOLVER_RUN_STATUS_INTERRUPTED;
+        break;
+      }
+      for (unsigned j = 0; j != fds.size() && winner < 0; ++j) {
+        if (!fds[j].revents)
+          continue;
+        Racer &r = racers[owners[j]];
+        char buffer[4096];
+        ssize_t n = read(r.fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n > 0) {
+          r.message.append(buffer, n);
+          continue;
+        }
+        ::close(r.fd);
+        r.fd = -1;
+        --running;
+        Backend &b = backends[owners[j]];
+        if (r.message.size() >= 2 && r.message[0]) {
+          winner = owners[j];
+          ++b.wins;
+          b.winTime += time::getWallTime() - start;
+          status = static_cast<SolverRunStatus>(r.message[1]);
+          result = r.message.substr(2);
+        } else {
+          ++b.failures;
+          if (r.message.size() >= 2)
+            status = static_cast<SolverRunStatus>(r.message[1]);
+        }
+      }
+    }
+
+    // cancel the losers
+    for (Racer &r : racers) {
+      if (r.pid < 0)
+        continue;
+      if (r.fd >= 0) {
+        kill(r.pid, SIGKILL);
+        ::close(r.fd);
+      }
+      while (waitpid(r.pid, nullptr, 0) < 0 && errno == EINTR)
+        ;
+    }
+    return winner >= 0;
+  }
+
+public:
+  /// Takes ownership of the solvers in \p _backends.
+  explicit PortfolioSolver(std::vector<Backend> _backends)
+      : backends(std::move(_backends)) {}
+
+  ~PortfolioSolver() {
+    for (Backend &b : backends)
+      delete b.solver;
+  }
+
+  const std::vector<Backend> &getBackends() const { return backends; }
+
+  /// One line per backend with its wins, failures and mean time to win.
+  void printStats(llvm::raw_ostream &os) const {
+    for (const Backend &b : backends) {
+      os << "Portfolio: " << b.name << " wins " << b.wins << " failures "
+         << b.failures << " mean-win-time ";
+      if (b.wins)
+        os << llvm::format("%.6f", b.winTime.toSeconds() / b.wins) << "s";
+      else
+        os << "-";
+      os << "\n";
+    }
+  }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    std::string data;
+    return race(
+               [&query](Solver *s, std::string &out) {
+                 Solver::Validity v;
+                 if (!s->impl->computeValidity(query, v))
+                   return false;
+                 QueryResultCodec::encodeValidity(v, out);
+                 return true;
+               },
+               data) &&
+           QueryResultCodec::decodeValidity(data, result);
+  }
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    std::string data;
+    return race(
+               [&query](Solver *s, std::string &out) {
+                 bool v;
+                 if (!s->impl->computeTruth(query, v))
+                   return false;
+                 QueryResultCodec::encodeTruth(v, out);
+                 return true;
+               },
+               data) &&
+           QueryResultCodec::decodeTruth(data, isValid);
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    std::string data;
+    return race(
+               [&query](Solver *s, std::string &out) {
+                 ref<Expr> v;
+                 return s->impl->computeValue(query, v) &&
+                        QueryResultCodec::encodeValue(v, out);
+               },
+               data) &&
+           QueryResultCodec::decodeValue(data, result);
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    std::string data;
+    return race(
+               [&](Solver *s, std::string &out) {
+                 std::vector<std::vector<unsigned char> > v;
+                 bool solvable;
+                 if (!s->impl->computeInitialValues(query, objects, v,
+                                                    solvable))
+                   return false;
+                 QueryResultCodec::encodeInitialValues(v, solvable, out);
+                 return true;
+               },
+               data) &&
+           QueryResultCodec::decodeInitialValues(data, objects.size(), values,
+                                                 hasSolution);
+  }
+
+  SolverRunStatus getOperationStatusCode() { return status; }
+
+  /// The constraint log of the first backend only; the logs of the other
+  /// backends are not included.
+  char *getConstraintLog(const Query &query) {
+    return backends.front().solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(time::Span timeout) {
+    for (Backend &b : backends)
+      b.solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+/// Create a portfolio of the core solvers \p types (see
+/// createCoreSolver()). Returns null if one of them is not available.
+inline Solver *
+createPortfolioSolver(const std::vector<CoreSolverType> &types) {
+  std::vector<PortfolioSolver::Backend> backends;
+  for (CoreSolverType type : types) {
+    Solver *s = createCoreSolver(type);
+    if (!s) {
+      for (auto &b : backends)
+        delete b.solver;
+      return nullptr;
+    }
+    const char *name = type == STP_SOLVER       ? "stp"
+                       : type == Z3_SOLVER      ? "z3"
+                       : type == METASMT_SOLVER ? "metasmt"
+                                                : "dummy";
+    backends.emplace_back(name, s);
+  }
+  return new Solver(new PortfolioSolver(std::move(backends)));
+}
+
+} // End klee namespace
+
+#endif /* KLEE_PORTFOLIOSOLVER_H */
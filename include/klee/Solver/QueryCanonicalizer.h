@@ -0,0 +1,307 @@
+//===-- QueryCanonicalizer.h ------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_QUERYCANONICALIZER_H
+#define KLEE_QUERYCANONICALIZER_H
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/Support/MD5.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace klee {
+
+/// QueryCanonicalizer - Computes a form of a query that does not depend on
+/// the names of its symbolic arrays, the order of its constraints or the
+/// operand order of commutative operations, so that queries differing only
+/// in these (e.g. over "arg0" in one state and "arg0_1" in another) share
+/// cache entries.
+///
+/// Symbolic arrays are numbered in the order they first occur; constant
+/// arrays are described by their contents. The constraints and the
+/// operands of commutative operations are ordered by a structural hash
+/// that ignores array names. The result is a serialization that fully
+/// determines the query up to renaming arrays, so equal forms always mean
+/// equivalent queries; the ordering only decides how many equivalent
+/// queries get the same form. Shared subexpressions are serialized once
+/// and referred to afterwards, so the form is linear in the size of the
+/// expression DAG.
+///
+/// The objects asked for by computeInitialValues are appended in their
+/// order, so equal forms also agree on which object a value belongs to.
+class QueryCanonicalizer {
+  enum Tag : char {
+    TagExpr = 'e',
+    TagRef = 'r',
+    TagSymbolic = 's',
+    TagConstantArray = 'c',
+    TagUpdates = 'u',
+    TagEnd = '.'
+  };
+
+  std::string form;
+  std::vector<const Array *> arrays; // by canonical number
+  std::unordered_map<const Array *, uint64_t> arrayNumbers;
+  std::unordered_map<const Expr *, uint64_t> exprIds;
+  std::unordered_map<const UpdateNode *, uint64_t> updateIds;
+  std::unordered_map<const Expr *, uint64_t> shapes;
+  std::unordered_map<const UpdateNode *, uint64_t> updateShapes;
+
+  static uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    return h * 0xbf58476d1ce4e5b9ULL;
+  }
+
+  static bool isCommutative(Expr::Kind k) {
+    switch (k) {
+    case Expr::Add:
+    case Expr::Mul:
+    case Expr::And:
+    case Expr::Or:
+    case Expr::Xor:
+    case Expr::Eq:
+    case Expr::Ne:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static uint64_t getConstantHash(const llvm::APInt &v) {
+    uint64_t h = v.getBitWidth();
+    for (unsigned i = 0, e = v.getNumWords(); i != e; ++i)
+      h = mix(h, v.getRawData()[i]);
+    return h;
+  }
+
+  static uint64_t getArrayShape(const Array *a) {
+    uint64_t h = mix(mix(mix(a->isConstantArray(), a->getSize()),
+                         a->getDomain()),
+                     a->getRange());
+    for (const auto &v : a->constantValues)
+      h = mix(h, getConstantHash(v->getAPValue()));
+    return h;
+  }
+
+  uint64_t getUpdateShape(const UpdateNode *un) {
+    if (!un)
+      return 0;
+    auto it = updateShapes.find(un);
+    if (it != updateShapes.end())
+      return it->second;
+    // iterate, the chains can be long
+    std::vector<const UpdateNode *> chain;
+    for (; un && !updateShapes.count(un); un = un->next)
+      chain.push_back(un);
+    uint64_t h = un ? updateShapes[un] : 0;
+    for (auto i = chain.rbegin(), e = chain.rend(); i != e; ++i) {
+      h = mix(mix(h, getShape((*i)->index)), getShape((*i)->value));
+      updateShapes[*i] = h;
+    }
+    return h;
+  }
+
+  /// A hash of the structure of \p e that ignores array names and the
+  /// operand order of commutative operations.
+  uint64_t getShape(const ref<Expr> &e) {
+    auto it = shapes.find(e.get());
+    if (it != shapes.end())
+      return it->second;
+    uint64_t h = mix(e->getKind(), e->getWidth());
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+      h = mix(h, getConstantHash(ce->getAPValue()));
+    } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      h = mix(mix(h, getArrayShape(re->updates.root)),
+              getUpdateShape(re->updates.head));
+      h = mix(h, getShape(re->index));
+    } else {
+      if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e))
+        h = mix(h, ee->offset);
+      std::vector<uint64_t> kids;
+      for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+        kids.push_back(getShape(e->getKid(i)));
+      if (isCommutative(e->getKind()))
+        std::sort(kids.begin(), kids.end());
+      for (uint64_t k : kids)
+        h = mix(h, k);
+    }
+    shapes[e.get()] = h;
+    return h;
+  }
+
+  void write(uint64_t v) {
+    do {
+      form.push_back(static_cast<char>((v & 0x7f) | (v > 0x7f ? 0x80 : 0)));
+      v >>= 7;
+    } while (v);
+  }
+
+  void writeConstant(const llvm::APInt &v) {
+    write(v.getBitWidth());
+    for (unsigned i = 0, e = v.getNumWords(); i != e; ++i)
+      write(v.getRawData()[i]);
+  }
+
+  void writeArray(const Array *a) {
+    if (a->isConstantArray()) {
+      form.push_back(TagConstantArray);
+      write(a->getSize());
+      write(a->getDomain());
+      write(a->getRange());
+      for (const auto &v : a->constantValues)
+        writeConstant(v->getAPValue());
+      return;
+    }
+    auto it = arrayNumbers.find(a);
+    form.push_back(TagSymbolic);
+    if (it != arrayNumbers.end()) {
+      write(it->second);
+      return;
+    }
+    // the first occurrence also records the shape of the array
+    arrayNumbers[a] = arrays.size();
+    write(arrays.size());
+    arrays.push_back(a);
+    write(a->getSize());
+    write(a->getDomain());
+    write(a->getRange());
+  }
+
+  void writeUpdates(const UpdateNode *un) {
+    std::vector<const UpdateNode *> chain;
+    for (; un && !updateIds.count(un); un = un->next)
+      chain.push_back(un);
+    form.push_back(TagUpdates);
+    write(chain.size());
+    for (const UpdateNode *node : chain) {
+      writeExpr(node->index);
+      writeExpr(node->value);
+    }
+    if (un) {
+      form.push_back(TagRef);
+      write(updateIds[un]);
+    } else {
+      form.push_back(TagEnd);
+    }
+    // number the nodes in the order their contents were written
+    for (const UpdateNode *node : chain)
+      updateIds.emplace(node, updateIds.size());
+  }
+
+  void writeExpr(const ref<Expr> &e) {
+    auto it = exprIds.find(e.get());
+    if (it != exprIds.end()) {
+      form.push_back(TagRef);
+      write(it->second);
+      return;
+    }
+    form.push_back(TagExpr);
+    write(e->getKind());
+    write(e->getWidth());
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+      writeConstant(ce->getAPValue());
+    } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      writeArray(re->updates.root);
+      writeUpdates(re->updates.head);
+      writeExpr(re->index);
+    } else {
+      if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e))
+        write(ee->offset);
+      std::vector<ref<Expr> > kids;
+      for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+        kids.push_back(e->getKid(i));
+      if (isCommutative(e->getKind()))
+        std::stable_sort(kids.begin(), kids.end(),
+                         [this](const ref<Expr> &a, const ref<Expr> &b) {
+                           return getShape(a) < getShape(b);
+                         });
+      for (const ref<Expr> &kid : kids)
+        writeExpr(kid);
+    }
+    exprIds.emplace(e.get(), exprIds.size());
+  }
+
+public:
+  /// Compute the canonical form of \p query, including \p objects if
+  /// given.
+  void canonicalize(const Query &query,
+                    const std::vector<const Array *> *objects = nullptr) {
+    form.clear();
+    arrays.clear();
+    arrayNumbers.clear();
+    exprIds.clear();
+    updateIds.clear();
+
+    std::vector<ref<Expr> > constraints(query.constraints.begin(),
+                                        query.constraints.end());
+    std::stable_sort(constraints.begin(), constraints.end(),
+                     [this](const ref<Expr> &a, const ref<Expr> &b) {
+                       return getShape(a) < getShape(b);
+                     });
+    write(constraints.size());
+    for (const ref<Expr> &c : constraints)
+      writeExpr(c);
+    writeExpr(query.expr);
+    if (objects) {
+      write(objects->size());
+      for (const Array *a : *objects)
+        writeArray(a);
+    }
+
+    // the shapes only depend on the expressions, but memory would keep
+    // growing with every query
+    shapes.clear();
+    updateShapes.clear();
+  }
+
+  /// The canonical form of the last query.
+  const std::string &getForm() const { return form; }
+
+  /// The symbolic arrays of the last query by canonical number, i.e. the
+  /// renaming applied to it. Use it to carry models between queries with
+  /// the same form.
+  const std::vector<const Array *> &getArrays() const { return arrays; }
+
+  /// A 64 bit hash of the canonical form, e.g. for in-memory caches.
+  uint64_t getHash() const {
+    uint64_t h = form.size();
+    for (unsigned char c : form)
+      h = mix(h, c);
+    return h;
+  }
+
+  /// A 128 bit digest of the canonical form, for caches shared across
+  /// runs, where collisions must be practically impossible.
+  std::pair<uint64_t, uint64_t> getDigest() const {
+    llvm::MD5 md5;
+    md5.update(form);
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    std::pair<uint64_t, uint64_t> digest(0, 0);
+    for (unsigned i = 0; i != 8; ++i) {
+      digest.first |= uint64_t(result[i]) << (8 * i);
+      digest.second |= uint64_t(result[i + 8]) << (8 * i);
+    }
+    return digest;
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_QUERYCANONICALIZER_H */
@@ -0,0 +1,127 @@
+//===-- QueryResultCodec.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_QUERYRESULTCODEC_H
+#define KLEE_QUERYRESULTCODEC_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+/// QueryResultCodec - Binary encodings of solver answers, for answers that
+/// leave the process: stored in a PersistentQueryCache or sent back by a
+/// forked solver. Every decode function checks its input and returns false
+/// on anything that is not a complete encoding.
+class QueryResultCodec {
+  template <typename T> static void append(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+
+  template <typename T> static bool consume(llvm::StringRef &in, T &v) {
+    if (in.size() < sizeof(v))
+      return false;
+    memcpy(&v, in.data(), sizeof(v));
+    in = in.drop_front(sizeof(v));
+    return true;
+  }
+
+public:
+  static void encodeValidity(Solver::Validity v, std::string &out) {
+    out.push_back(static_cast<char>(int(v) + 1));
+  }
+
+  static bool decodeValidity(llvm::StringRef in, Solver::Validity &v) {
+    if (in.size() != 1 || uint8_t(in[0]) > 2)
+      return false;
+    v = static_cast<Solver::Validity>(int(uint8_t(in[0])) - 1);
+    return true;
+  }
+
+  static void encodeTruth(bool isValid, std::string &out) {
+    out.push_back(static_cast<char>(isValid));
+  }
+
+  static bool decodeTruth(llvm::StringRef in, bool &isValid) {
+    if (in.size() != 1 || uint8_t(in[0]) > 1)
+      return false;
+    isValid = in[0];
+    return true;
+  }
+
+  /// Only constants can be encoded; returns false for other expressions.
+  static bool encodeValue(const ref<Expr> &e, std::string &out) {
+    const ConstantExpr *ce = dyn_cast<ConstantExpr>(e);
+    if (!ce)
+      return false;
+    const llvm::APInt &value = ce->getAPValue();
+    append<uint32_t>(out, value.getBitWidth());
+    out.append(reinterpret_cast<const char *>(value.getRawData()),
+               value.getNumWords() * sizeof(uint64_t));
+    return true;
+  }
+
+  static bool decodeValue(llvm::StringRef in, ref<Expr> &e) {
+    uint32_t width;
+    if (!consume(in, width) || !width ||
+        in.size() != (width + 63) / 64 * sizeof(uint64_t))
+      return false;
+    std::vector<uint64_t> words(in.size() / sizeof(uint64_t));
+    memcpy(words.data(), in.data(), in.size());
+    e = ConstantExpr::alloc(llvm::APInt(width, words));
+    return true;
+  }
+
+  static void
+  encodeInitialValues(const std::vector<std::vector<unsigned char> > &values,
+                      bool hasSolution, std::string &out) {
+    append<uint8_t>(out, hasSolution);
+    if (!hasSolution)
+      return;
+    for (const auto &v : values) {
+      append<uint32_t>(out, v.size());
+      out.append(v.begin(), v.end());
+    }
+  }
+
+  /// \p numObjects is the number of objects the values were asked for.
+  static bool
+  decodeInitialValues(llvm::StringRef in, size_t numObjects,
+                      std::vector<std::vector<unsigned char> > &values,
+                      bool &hasSolution) {
+    uint8_t solvable;
+    if (!consume(in, solvable) || solvable > 1)
+      return false;
+    std::vector<std::vector<unsigned char> > decoded;
+    for (size_t i = 0; solvable && i != numObjects; ++i) {
+      uint32_t size;
+      if (!consume(in, size) || size > in.size())
+        return false;
+      decoded.emplace_back(in.bytes_begin(), in.bytes_begin() + size);
+      in = in.drop_front(size);
+    }
+    if (!in.empty())
+      return false;
+    hasSolution = solvable;
+    values = std::move(decoded);
+    return true;
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_QUERYRESULTCODEC_H */
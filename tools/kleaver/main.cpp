@@ -19,6 +19,10 @@
 #include "klee/Expr/Parser/Parser.h"
 #include "klee/Internal/Support/PrintVersion.h"
 #include "klee/OptionCategories.h"
+#include "klee/Solver/CanonicalCachingSolver.h"
+#include "klee/Solver/PersistentCachingSolver.h"
+#include "klee/Solver/PersistentQueryCache.h"
+#include "klee/Solver/PortfolioSolver.h"
 #include "klee/Solver/Solver.h"
 #include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverImpl.h"
@@ -89,6 +93,30 @@ llvm::cl::opt<bool> ClearArrayAfterQuery(
     llvm::cl::desc("Discard the previous array declarations after a query "
                    "is performed (default=false)"),
     llvm::cl::init(false), llvm::cl::cat(klee::ExprCat));
+
+llvm::cl::opt<std::string> PersistentQueryCacheFile(
+    "persistent-query-cache",
+    llvm::cl::desc("Keep solver results in this file and reuse them across "
+                   "runs; concurrent runs may share it (default=off)"),
+    llvm::cl::init(""), llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<bool> UseCanonicalCache(
+    "use-canonical-cache",
+    llvm::cl::desc("Cache solver results keyed by the canonical form of the "
+                   "query, so that queries differing only in array names "
+                   "share them (default=false)"),
+    llvm::cl::init(false), llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::list<CoreSolverType> SolverPortfolio(
+    "solver-portfolio",
+    llvm::cl::desc("Race these core solvers in forked processes on every "
+                   "query and take the first answer, instead of using "
+                   "--solver-backend"),
+    llvm::cl::values(clEnumValN(STP_SOLVER, "stp", "STP"),
+                     clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+                     clEnumValN(Z3_SOLVER, "z3", "Z3")
+                         KLEE_LLVM_CL_VAL_END),
+    llvm::cl::CommaSeparated, llvm::cl::cat(klee::SolvingCat));
 } // namespace
 
 static std::string getQueryLogPath(const char filename[])
@@ -202,15 +230,44 @@ static bool EvaluateInputAST(const char *Filename,
   if (!success)
     return false;
 
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
+  Solver *coreSolver;
+  PortfolioSolver *portfolio = nullptr;
+  if (!SolverPortfolio.empty()) {
+    std::vector<CoreSolverType> types(SolverPortfolio.begin(),
+                                      SolverPortfolio.end());
+    coreSolver = createPortfolioSolver(types);
+    if (!coreSolver) {
+      llvm::errs() << "--solver-portfolio: a solver is not available\n";
+      return false;
+    }
+    portfolio = static_cast<PortfolioSolver *>(coreSolver->impl);
+  } else {
+    coreSolver = klee::createCoreSolver(CoreSolverToUse);
+  }
 
-  if (CoreSolverToUse != DUMMY_SOLVER) {
+  if (portfolio || CoreSolverToUse != DUMMY_SOLVER) {
     const time::Span maxCoreSolverTime(MaxCoreSolverTime);
     if (maxCoreSolverTime) {
       coreSolver->setCoreSolverTimeout(maxCoreSolverTime);
     }
   }
 
+  PersistentQueryCache cache;
+  if (!PersistentQueryCacheFile.empty()) {
+    std::string error;
+    if (!cache.open(PersistentQueryCacheFile, error)) {
+      llvm::errs() << "--persistent-query-cache: " << error << "\n";
+      delete coreSolver;
+      return false;
+    }
+    coreSolver = createPersistentCachingSolver(coreSolver, cache);
+  }
+  CanonicalCachingSolver *canonicalCache = nullptr;
+  if (UseCanonicalCache) {
+    canonicalCache = new CanonicalCachingSolver(coreSolver);
+    coreSolver = new Solver(canonicalCache);
+  }
+
   Solver *S = constructSolverChain(coreSolver,
                                    getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
                                    getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
@@ -297,6 +354,16 @@ static bool EvaluateInputAST(const char *Filename,
     delete *it;
   delete P;
 
+  // taken before the solvers go with the chain
+  std::string solverStats;
+  llvm::raw_string_ostream solverStatsOS(solverStats);
+  if (canonicalCache)
+    solverStatsOS << "canonical cache hits = " << canonicalCache->getNumHits()
+                  << "\n"
+                  << "canonical cache misses = "
+                  << canonicalCache->getNumMisses() << "\n";
+  if (portfolio)
+    portfolio->printStats(solverStatsOS);
   delete S;
 
   if (uint64_t queries = *theStatisticManager->getStatisticByName("Queries")) {
@@ -312,6 +379,11 @@ static bool EvaluateInputAST(const char *Filename,
       << "query cex = " 
       << *theStatisticManager->getStatisticByName("QueriesCEX") << "\n";
   }
+  llvm::outs() << solverStatsOS.str();
+  if (cache.isOpen())
+    llvm::outs() << "persistent cache hits = " << cache.getNumHits() << "\n"
+                 << "persistent cache misses = " << cache.getNumMisses()
+                 << "\n";
 
   return success;
 }
@@ -12,8 +12,16 @@
 #include "klee/Config/Version.h"
 #include "klee/ExecutionState.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Internal/ADT/BehaviorSet.h"
+#include "klee/Internal/ADT/BranchHistory.h"
 #include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/SharedCoverageTable.h"
 #include "klee/Internal/ADT/TreeStream.h"
+#include "klee/Internal/Module/BranchDependences.h"
+#include "klee/Internal/Module/BranchValueMaps.h"
+#include "klee/Internal/Module/ErrorTargets.h"
+#include "klee/Internal/Module/KInstruction.h"
+#include "klee/Internal/Module/ModuleKey.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Internal/Support/FileHandling.h"
@@ -57,6 +65,7 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <ctime>
 #include <fstream>
@@ -137,6 +146,23 @@ namespace {
              cl::init(true),
              cl::cat(TestCaseCat));
 
+  cl::opt<bool>
+  WriteBinaryPaths("write-binary-paths",
+                   cl::desc("Write .path files in the compact binary format instead of "
+                            "one decision per line; --replay-path reads both (default=false)"),
+                   cl::cat(TestCaseCat));
+
+  cl::opt<bool>
+  SuppressDuplicateBehaviors("suppress-duplicate-behaviors",
+                             cl::desc("Do not write test cases (other than for errors) for "
+                                      "paths that took the same directions at the same "
+                                      "branches as an earlier path. Only which directions "
+                                      "each branch took is compared, not their order or "
+                                      "count, so paths differing only in those (e.g. in "
+                                      "loop iterations) count as duplicates "
+                                      "(default=false)"),
+                             cl::cat(TestCaseCat));
+
   cl::opt<bool>
   WriteSymPaths("write-sym-paths",
                 cl::desc("Write .sym.path files for each test case (default=false)"),
@@ -165,6 +191,12 @@ namespace {
   cl::opt<std::string>
   ErrorLocation("error-location",
                 cl::desc("Comma-separated list of locations where a failure is expected (e.g. <file1>[:line],<file2>[:line],..)"));
+
+  cl::opt<bool>
+  HaltOnAllTargets("halt-on-all-targets",
+                   cl::desc("Stop execution once an error has been found at every "
+                            "--error-location target (default=false)"),
+                   cl::init(false));
               
     
   cl::opt<int>
@@ -195,6 +227,22 @@ namespace {
             cl::init(""),
             cl::cat(StartCat));
 
+  cl::opt<std::string>
+  SharedCoverageFile("shared-coverage",
+                     cl::desc("Share the behaviors seen by --suppress-duplicate-behaviors "
+                              "with other klee processes exploring the same program "
+                              "through this file, so that none of them writes a test "
+                              "case for a behavior another one has written (default=off)"),
+                     cl::init(""),
+                     cl::cat(StartCat));
+
+  cl::opt<unsigned>
+  SharedBehaviorSlots("shared-behavior-slots",
+                      cl::desc("Number of behaviors the shared coverage table can "
+                               "hold (default=1048576)"),
+                      cl::init(1u << 20),
+                      cl::cat(StartCat));
+
   cl::opt<std::string>
   Environ("env-file",
           cl::desc("Parse environment from the given file (in \"env\" format)"),
@@ -360,6 +408,18 @@ private:
   unsigned m_numTotalTests;     // Number of tests received from the interpreter
   unsigned m_numGeneratedTests; // Number of tests successfully generated
   unsigned m_pathsExplored; // number of paths explored so far
+  unsigned m_numSuppressedTests; // Number of tests with a known behavior
+  BehaviorSet m_behaviors; // branch decisions of the paths seen so far
+
+  // per --error-location target bookkeeping
+  struct TargetHits {
+    unsigned hits = 0;
+    time::Span firstHit; // since the start of the run
+  };
+  ErrorTargets *m_targets;
+  std::vector<TargetHits> m_targetHits;
+  time::Point m_startTime;
+  SharedCoverageTable *m_sharedCoverage; // behaviors of other processes
 
   // used for writing .ktest files
   int m_argc;
@@ -373,9 +433,16 @@ public:
   /// Returns the number of test cases successfully generated so far
   unsigned getNumTestCases() { return m_numGeneratedTests; }
   unsigned getNumPathsExplored() { return m_pathsExplored; }
+  unsigned getNumSuppressedTests() { return m_numSuppressedTests; }
   void incPathsExplored() { m_pathsExplored++; }
 
   void setInterpreter(Interpreter *i);
+  void setTargets(ErrorTargets *targets);
+  void setSharedCoverage(SharedCoverageTable *table) { m_sharedCoverage = table; }
+  bool isKnownBehavior(const ExecutionState &state);
+  void setStartTime(time::Point start) { m_startTime = start; }
+  void recordTargetHits(const ExecutionState &state);
+  void writeTargetSummary(llvm::raw_ostream &os) const;
 
   void processTestCase(const ExecutionState  &state,
                        const char *errorMessage,
@@ -399,7 +466,9 @@ public:
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0),
       m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
-      m_pathsExplored(0), m_argc(argc), m_argv(argv) {
+      m_pathsExplored(0), m_numSuppressedTests(0), m_targets(0),
+      m_startTime(time::getWallTime()), m_sharedCoverage(0), m_argc(argc),
+      m_argv(argv) {
 
   // create output directory (OutputDir or "klee-out-<i>")
   bool dir_given = OutputDir != "";
@@ -489,6 +558,75 @@ void KleeHandler::setInterpreter(Interpreter *i) {
   }
 }
 
+void KleeHandler::setTargets(ErrorTargets *targets) {
+  m_targets = targets;
+  m_targetHits.assign(targets ? targets->getNumTargets() : 0, TargetHits());
+}
+
+/// Attribute an error of \p state to the targets at the location of the
+/// instruction that failed or of a call on the stack, so that errors
+/// raised in a called function (e.g. abort() for an assert) count for the
+/// line that called it. The first hit of a target is reported.
+void KleeHandler::recordTargetHits(const ExecutionState &state) {
+  if (!m_targets)
+    return;
+  std::vector<unsigned> hit;
+  if (const KInstruction *ki = state.prevPC)
+    m_targets->getTargetsAt(ki->info->file, ki->info->line, hit);
+  for (const StackFrame &sf : state.stack)
+    if (const KInstruction *caller = sf.caller)
+      m_targets->getTargetsAt(caller->info->file, caller->info->line, hit);
+  if (hit.empty())
+    return;
+  std::sort(hit.begin(), hit.end());
+  hit.erase(std::unique(hit.begin(), hit.end()), hit.end());
+  for (unsigned t : hit) {
+    TargetHits &h = m_targetHits[t];
+    if (!h.hits++)
+      h.firstHit = time::getWallTime() - m_startTime;
+    if (!m_targets->markHit(t))
+      continue;
+    const ErrorTargets::Target &target = m_targets->getTarget(t);
+    klee_message("hit target %s:%u after %.2fs, %u target(s) left",
+                 target.file.c_str(), target.line, h.firstHit.toSeconds(),
+                 m_targets->getNumRemainingTargets());
+  }
+  if (HaltOnAllTargets && !m_targets->getNumRemainingTargets()) {
+    klee_message("all --error-location targets hit, halting");
+    m_interpreter->setHaltExecution(true);
+  }
+}
+
+/// Record the behavior of \p state, locally and in the shared table.
+/// Returns true if this or a cooperating process has seen it before.
+bool KleeHandler::isKnownBehavior(const ExecutionState &state) {
+  bool isNew = m_behaviors.insert(state.brSet);
+  if (m_sharedCoverage &&
+      !m_sharedCoverage->insertBehavior(state.brSet.getHash()))
+    isNew = false;
+  return !isNew;
+}
+
+void KleeHandler::writeTargetSummary(llvm::raw_ostream &os) const {
+  if (m_targetHits.empty())
+    return;
+  os << "Target hits:\n";
+  for (unsigned t = 0, e = m_targetHits.size(); t != e; ++t) {
+    const ErrorTargets::Target &target = m_targets->getTarget(t);
+    std::stringstream location, line;
+    location << target.file;
+    if (target.line)
+      location << ':' << target.line;
+    line << "  " << std::left << std::setw(40) << location.str() << ' ';
+    if (m_targetHits[t].hits)
+      line << "hits " << std::setw(6) << m_targetHits[t].hits
+           << " first " << m_targetHits[t].firstHit.toSeconds() << "s";
+    else
+      line << "not hit";
+    os << line.str() << '\n';
+  }
+}
+
 std::string KleeHandler::getOutputFilename(const std::string &filename) {
   SmallString<128> path = m_outputDirectory;
   sys::path::append(path,filename);
@@ -526,6 +664,15 @@ KleeHandler::openTestFile(const std::string &suffix, unsigned id) {
 void KleeHandler::processTestCase(const ExecutionState &state,
                                   const char *errorMessage,
                                   const char *errorSuffix) {
+  // checked before solving for the test case, which is the expensive part
+  if (SuppressDuplicateBehaviors && !errorMessage && isKnownBehavior(state)) {
+    ++m_numSuppressedTests;
+    return;
+  }
+
+  if (errorMessage)
+    recordTargetHits(state);
+
   if (!WriteNone) {
     std::vector< std::pair<std::string, std::vector<unsigned char> > > out;
     bool success = m_interpreter->getSymbolicSolution(state, out);
@@ -578,7 +725,14 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       m_pathWriter->readStream(m_interpreter->getPathStreamID(state),
                                concreteBranches);
       auto f = openTestFile("path", id);
-      if (f) {
+      if (f && WriteBinaryPaths) {
+        BranchHistory history;
+        for (const auto &branch : concreteBranches)
+          history.push_back(branch != '0');
+        std::string encoded;
+        history.encode(encoded);
+        *f << encoded;
+      } else if (f) {
         for (const auto &branch : concreteBranches) {
           *f << branch << '\n';
         }
@@ -656,6 +810,16 @@ void KleeHandler::processTestCase(const ExecutionState &state,
   // load a .path file
 void KleeHandler::loadPathFile(std::string name,
                                      std::vector<bool> &buffer) {
+  auto data = MemoryBuffer::getFile(name);
+  if (data && BranchHistory::isEncoded((*data)->getBuffer())) {
+    BranchHistory history;
+    if (!history.decode((*data)->getBuffer()))
+      klee_error("invalid binary path file \"%s\"", name.c_str());
+    std::vector<bool> decoded = history.toVector();
+    buffer.insert(buffer.end(), decoded.begin(), decoded.end());
+    return;
+  }
+
   std::ifstream f(name.c_str(), std::ios::in | std::ios::binary);
 
   if (!f.good())
@@ -1332,22 +1496,18 @@ int main(int argc, char **argv, char **envp) {
   // Push the module as the first entry
   loadedModules.emplace_back(std::move(M));
 
-  const auto dg_build_start_time = klee::time::getWallTime();
+  BranchDependences branchDeps;
+  branchDeps.numberModule(*mainModule);
+  BranchNumbering::set(&branchDeps);
   std::vector<llvm::Instruction*> initM;
-  for (llvm::Module::iterator fnIt = mainModule->begin(), fn_ie = mainModule->end();
-       fnIt != fn_ie; ++fnIt) {
-    for (llvm::Function::iterator bbIt = fnIt->begin(), bb_ie = fnIt->end();
-         bbIt != bb_ie; ++bbIt) {
-      for (llvm::BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end();
-           it != ie; ++it) {
-        if(it->getOpcode() == llvm::Instruction::Br && !cast<BranchInst>(it)->isUnconditional()){
-          initM.push_back(&*it);
-        }
-      }
-    }
-  }
+  initM.reserve(branchDeps.getNumBranches());
+  for (unsigned i = 0, e = branchDeps.getNumBranches(); i != e; ++i)
+    initM.push_back(branchDeps.getBranch(i));
+
+  const auto dg_build_start_time = klee::time::getWallTime();
   dg::llvmdg::LLVMDependenceGraphBuilder dg_builder(mainModule);
-  auto DG = dg_builder.build().get();
+  std::unique_ptr<dg::LLVMDependenceGraph> dgHolder = dg_builder.build();
+  dg::LLVMDependenceGraph *DG = dgHolder.get();
   time::Span dg_build_time(time::getWallTime() - dg_build_start_time);
   
   if (InjectFaults) {
@@ -1424,6 +1584,9 @@ int main(int argc, char **argv, char **envp) {
     
   std::map<std::string, std::vector<unsigned> > errorLocationOptions;
   parseErrorLocationParameter(ErrorLocation, errorLocationOptions);  
+
+  ErrorTargets errorTargets;
+  errorTargets.addTargets(errorLocationOptions);
   
   // FIXME: Change me to std types.
   int pArgc;
@@ -1502,6 +1665,7 @@ int main(int argc, char **argv, char **envp) {
     theInterpreter = Interpreter::create(ctx, IOpts, handler);
   assert(interpreter);
   handler->setInterpreter(interpreter);
+  handler->setTargets(&errorTargets);
 
   for (int i=0; i<argc; i++) {
     handler->getInfoStream() << argv[i] << (i+1<argc ? " ":"\n");
@@ -1521,6 +1685,19 @@ int main(int argc, char **argv, char **envp) {
 
   externalsAndGlobalsCheck(finalModule);
 
+  SharedCoverageTable sharedCoverage;
+  if (!SharedCoverageFile.empty()) {
+    if (!SuppressDuplicateBehaviors)
+      klee_error("--shared-coverage requires --suppress-duplicate-behaviors");
+    // processes may only share a table if they run the same final module
+    uint64_t key = getModuleKey(*finalModule);
+    std::string error;
+    if (!sharedCoverage.open(SharedCoverageFile, key, SharedBehaviorSlots,
+                             error))
+      klee_error("--shared-coverage: %s", error.c_str());
+    handler->setSharedCoverage(&sharedCoverage);
+  }
+
   if (ReplayPathFile != "") {
     interpreter->setReplayPath(&replayPath);
   }
@@ -1591,6 +1768,7 @@ int main(int argc, char **argv, char **envp) {
                    << " (" << ++i << "/" << kTestFiles.size() << ")\n";
       // XXX should put envp in .ktest ?
       
+      handler->setStartTime(time::getWallTime());
       interpreter->runFunctionAsMain(mainFn, out->numArgs, out->args, pEnvp, DG, initM);
       if (interrupted) break;
     }
@@ -1641,6 +1819,7 @@ int main(int argc, char **argv, char **envp) {
       }
     }
       
+    handler->setStartTime(time::getWallTime());
     interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp, DG, initM);
 
     while (!seeds.empty()) {
@@ -1713,6 +1892,9 @@ int main(int argc, char **argv, char **envp) {
         << handler->getNumPathsExplored() << "\n";
   stats << "KLEE: done: generated tests = "
         << handler->getNumTestCases() << "\n";
+  if (SuppressDuplicateBehaviors)
+    stats << "KLEE: done: suppressed tests = "
+          << handler->getNumSuppressedTests() << "\n";
 
   bool useColors = llvm::errs().is_displayed();
   if (useColors)
@@ -1726,6 +1908,7 @@ int main(int argc, char **argv, char **envp) {
     llvm::errs().resetColor();
 
   handler->getInfoStream() << stats.str();
+  handler->writeTargetSummary(handler->getInfoStream());
 
   delete handler;
 
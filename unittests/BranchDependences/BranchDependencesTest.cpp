@@ -0,0 +1,140 @@
+//===-- BranchDependencesTest.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Module/BranchDependenceClosure.h"
+#include "klee/Internal/Module/BranchDependences.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+
+/* Builds
+     entry: %c = icmp eq %x, 0 ; br %c, then, exit
+     then:  %d = icmp eq %y, 0 ; br %d, exit, exit
+     exit:  ret void
+   i.e. 5 instructions of which 2 are conditional branches. */
+std::unique_ptr<Module> buildModule(LLVMContext &ctx) {
+  std::unique_ptr<Module> m(new Module("test", ctx));
+  Type *i32 = Type::getInt32Ty(ctx);
+  FunctionType *fty =
+      FunctionType::get(Type::getVoidTy(ctx), {i32, i32}, false);
+  Function *f =
+      Function::Create(fty, GlobalValue::ExternalLinkage, "f", m.get());
+  auto args = f->arg_begin();
+  Value *x = &*args++;
+  Value *y = &*args;
+
+  BasicBlock *entry = BasicBlock::Create(ctx, "entry", f);
+  BasicBlock *then = BasicBlock::Create(ctx, "then", f);
+  BasicBlock *exit = BasicBlock::Create(ctx, "exit", f);
+
+  IRBuilder<> b(entry);
+  b.CreateCondBr(b.CreateICmpEQ(x, b.getInt32(0)), then, exit);
+  b.SetInsertPoint(then);
+  b.CreateCondBr(b.CreateICmpEQ(y, b.getInt32(0)), exit, exit);
+  b.SetInsertPoint(exit);
+  b.CreateRetVoid();
+  return m;
+}
+
+TEST(BranchDependencesTest, Numbering) {
+  LLVMContext ctx;
+  auto m = buildModule(ctx);
+  BranchDependences deps;
+  deps.numberModule(*m);
+
+  ASSERT_EQ(5u, deps.getNumInstructions());
+  ASSERT_EQ(2u, deps.getNumBranches());
+  EXPECT_EQ(1u, deps.getBranchInst(0));
+  EXPECT_EQ(3u, deps.getBranchInst(1));
+  EXPECT_EQ(1u, deps.getBranchID(deps.getInstruction(3)));
+  EXPECT_EQ(BranchDependences::InvalidID,
+            deps.getBranchID(deps.getInstruction(0)));
+}
+
+TEST(BranchDependencesTest, Edges) {
+  LLVMContext ctx;
+  auto m = buildModule(ctx);
+  BranchDependences deps;
+  deps.numberModule(*m);
+
+  // second compare is control dependent on the first branch, both
+  // branches depend on their compare
+  deps.addDependence(BranchDependences::Control, 2, 1);
+  deps.addDependence(BranchDependences::Control, 3, 1);
+  deps.addDependence(BranchDependences::Control, 3, 1);
+  deps.addDependence(BranchDependences::Data, 1, 0);
+  deps.addDependence(BranchDependences::Data, 3, 2);
+  deps.finalize();
+
+  EXPECT_EQ(2u, deps.getNumEdges(BranchDependences::Control));
+  EXPECT_EQ(2u, deps.getNumEdges(BranchDependences::Data));
+
+  auto r = deps.getDependences(BranchDependences::Control, 3);
+  ASSERT_EQ(1, r.second - r.first);
+  EXPECT_EQ(1u, *r.first);
+  r = deps.getDependences(BranchDependences::Control, 0);
+  EXPECT_EQ(r.first, r.second);
+  r = deps.getDependences(BranchDependences::Data, 3);
+  ASSERT_EQ(1, r.second - r.first);
+  EXPECT_EQ(2u, *r.first);
+}
+
+BranchIDSet makeSet(std::initializer_list<BranchID> ids) {
+  BranchIDSet s;
+  for (BranchID id : ids)
+    s.insert(id);
+  return s;
+}
+
+TEST(BranchDependencesTest, Closure) {
+  LLVMContext ctx;
+  auto m = buildModule(ctx);
+  BranchDependences deps;
+  deps.numberModule(*m);
+
+  // the second branch depends on the first one through its compare; the
+  // first branch depends on the second one directly, closing a cycle
+  deps.addDependence(BranchDependences::Control, 2, 1);
+  deps.addDependence(BranchDependences::Data, 3, 2);
+  deps.addDependence(BranchDependences::Data, 1, 3);
+  deps.finalize();
+
+  BranchDependenceClosure none(deps, 0);
+  EXPECT_TRUE(none.getClosure(0).empty());
+  EXPECT_TRUE(none.getClosure(1).empty());
+
+  BranchDependenceClosure one(deps, 1);
+  EXPECT_EQ(makeSet({1}), one.getClosure(0));
+  EXPECT_EQ(makeSet({0}), one.getClosure(1));
+  EXPECT_TRUE(one.dependsOn(1, 0));
+  EXPECT_FALSE(one.dependsOn(1, 1));
+
+  BranchDependenceClosure all(deps, -1);
+  all.precompute();
+  EXPECT_EQ(makeSet({0, 1}), all.getClosure(0));
+  EXPECT_TRUE(all.dependsOn(1, 1));
+
+  BranchIDSet s;
+  s.insert(70);
+  EXPECT_FALSE(one.intersects(0, s));
+  one.unionInto(0, s);
+  EXPECT_EQ(2u, s.size());
+  EXPECT_TRUE(one.intersects(0, s));
+}
+
+} // namespace
@@ -0,0 +1,148 @@
+//===-- BranchValueMapsTest.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Module/BranchValueMaps.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+
+/* Builds a function with three conditional branches on %x. */
+std::unique_ptr<Module> buildModule(LLVMContext &ctx) {
+  std::unique_ptr<Module> m(new Module("test", ctx));
+  Type *i32 = Type::getInt32Ty(ctx);
+  FunctionType *fty = FunctionType::get(Type::getVoidTy(ctx), {i32}, false);
+  Function *f =
+      Function::Create(fty, GlobalValue::ExternalLinkage, "f", m.get());
+  Value *x = &*f->arg_begin();
+
+  BasicBlock *bbs[4];
+  for (auto &bb : bbs)
+    bb = BasicBlock::Create(ctx, "", f);
+  IRBuilder<> b(bbs[0]);
+  for (unsigned i = 0; i != 3; ++i) {
+    b.SetInsertPoint(bbs[i]);
+    b.CreateCondBr(b.CreateICmpEQ(x, b.getInt32(i)), bbs[i + 1], bbs[3]);
+  }
+  b.SetInsertPoint(bbs[3]);
+  b.CreateRetVoid();
+  return m;
+}
+
+class BranchValueMapsTest : public ::testing::Test {
+protected:
+  LLVMContext ctx;
+  std::unique_ptr<Module> m;
+  BranchDependences deps;
+  Value *br[3];
+
+  void SetUp() override {
+    m = buildModule(ctx);
+    deps.numberModule(*m);
+    BranchNumbering::set(&deps);
+    for (unsigned i = 0; i != 3; ++i)
+      br[i] = deps.getBranch(i);
+  }
+
+  void TearDown() override { BranchNumbering::set(nullptr); }
+};
+
+TEST_F(BranchValueMapsTest, Decisions) {
+  BranchDecisionMap d;
+  d[br[2]] = BranchDecisions::True;
+  d[br[0]] |= BranchDecisions::False;
+  d[br[0]] |= BranchDecisions::True;
+
+  EXPECT_EQ(2u, d.size());
+  EXPECT_EQ(1u, d.count(br[2]));
+  EXPECT_EQ(0u, d.count(br[1]));
+  EXPECT_EQ(BranchDecisions::Both, d[br[0]]);
+  EXPECT_EQ(BranchDecisions::True, d.get(2));
+  EXPECT_TRUE(d.find(br[1]) == d.end());
+  EXPECT_EQ(BranchDecisions::True, d.find(br[2])->second);
+
+  std::vector<Value *> keys;
+  for (const auto &entry : d)
+    keys.push_back(entry.first);
+  EXPECT_EQ((std::vector<Value *>{br[0], br[2]}), keys);
+
+  d[br[0]] = BranchDecisions::False;
+  EXPECT_EQ(BranchDecisions::False, d[br[0]]);
+  EXPECT_EQ(1u, d.erase(br[0]));
+  EXPECT_EQ(0u, d.erase(br[0]));
+  EXPECT_EQ(1u, d.size());
+
+  // as with std::map, operator[] adds an entry, which may hold 0
+  EXPECT_EQ(0u, d[br[1]]);
+  EXPECT_EQ(1u, d.count(br[1]));
+  EXPECT_EQ(2u, d.size());
+}
+
+TEST_F(BranchValueMapsTest, Dependences) {
+  BranchDependenceMap a;
+  a[br[2]].insert(br[0]);
+  a[br[2]].insert(br[1]);
+  BranchDependenceMap b = a;
+  b[br[2]].insert(br[2]);
+  b[br[1]].insert(a[br[2]].begin(), a[br[2]].end());
+
+  EXPECT_EQ(2u, a[br[2]].size());
+  EXPECT_EQ(0u, a[br[2]].count(br[2]));
+  EXPECT_EQ(3u, b[br[2]].size());
+  EXPECT_EQ(1u, b[br[1]].count(br[0]));
+  EXPECT_EQ(0u, a.count(br[0]));
+  EXPECT_TRUE(a[br[0]].empty());
+  EXPECT_EQ(1u, a.count(br[0]));
+  EXPECT_EQ(2u, b.lookup(1)->size());
+
+  std::vector<Value *> keys;
+  for (auto it = b.begin(), ie = b.end(); it != ie; ++it) {
+    keys.push_back(it->first);
+    EXPECT_FALSE(it->second.empty());
+  }
+  EXPECT_EQ((std::vector<Value *>{br[1], br[2]}), keys);
+  EXPECT_EQ(br[1], b.find(br[1])->first);
+  EXPECT_TRUE(b.find(br[0]) == b.end());
+}
+
+TEST_F(BranchValueMapsTest, FreshIDs) {
+  // a branch added after numbering, like those of linked libraries
+  Function *g =
+      Function::Create(FunctionType::get(Type::getVoidTy(ctx), false),
+                       GlobalValue::ExternalLinkage, "g", m.get());
+  BasicBlock *bb = BasicBlock::Create(ctx, "", g);
+  IRBuilder<> b(bb);
+  Value *late = b.CreateCondBr(b.getTrue(), bb, bb);
+
+  BranchDecisionMap d;
+  EXPECT_EQ(0u, d.count(late));
+  EXPECT_TRUE(d.find(late) == d.end());
+  EXPECT_EQ(BranchDependences::InvalidID, BranchNumbering::lookup(late));
+  d[late] = '1';
+  EXPECT_EQ(3u, BranchNumbering::lookup(late));
+  EXPECT_EQ(late, BranchNumbering::getBranch(3));
+  EXPECT_EQ(late, d.find(late)->first);
+  EXPECT_EQ('1', d[late]);
+
+  BranchDependenceMap sets;
+  sets[br[0]].insert(late);
+  EXPECT_EQ(1u, sets[br[0]].count(late));
+  EXPECT_EQ(3u, BranchNumbering::getID(late));
+}
+
+} // namespace
@@ -0,0 +1,91 @@
+//===-- BranchHistoryTest.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/BranchHistory.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+BranchHistory roundTrip(const BranchHistory &h) {
+  std::string encoded;
+  h.encode(encoded);
+  EXPECT_TRUE(BranchHistory::isEncoded(encoded));
+  BranchHistory decoded;
+  EXPECT_TRUE(decoded.decode(encoded));
+  return decoded;
+}
+
+TEST(BranchHistoryTest, PushBack) {
+  BranchHistory h;
+  EXPECT_TRUE(h.empty());
+  for (unsigned i = 0; i != 130; ++i)
+    h.push_back(i % 3 == 0);
+  ASSERT_EQ(130u, h.size());
+  EXPECT_TRUE(h.isTaken(0));
+  EXPECT_FALSE(h.isTaken(64));
+  EXPECT_TRUE(h.isTaken(129));
+  EXPECT_EQ('1', h.back());
+  EXPECT_EQ(130u, h.toVector().size());
+  EXPECT_LE(3 * sizeof(uint64_t), h.getMemoryUsage());
+}
+
+TEST(BranchHistoryTest, Raw) {
+  BranchHistory h;
+  for (unsigned i = 0; i != 100; ++i)
+    h.push_back(i % 2);
+  EXPECT_EQ(h, roundTrip(h));
+  EXPECT_EQ(BranchHistory(), roundTrip(BranchHistory()));
+}
+
+TEST(BranchHistoryTest, RunLength) {
+  // a loop taken many times is stored as a few runs
+  BranchHistory h;
+  h.push_back(false);
+  for (unsigned i = 0; i != 100000; ++i)
+    h.push_back(true);
+  h.push_back(false);
+  std::string encoded;
+  h.encode(encoded);
+  EXPECT_GT(20u, encoded.size());
+  EXPECT_EQ(h, roundTrip(h));
+}
+
+TEST(BranchHistoryTest, Invalid) {
+  BranchHistory h;
+  EXPECT_FALSE(h.decode("1\n0\n"));
+  h.push_back(true);
+  h.push_back(false);
+  std::string encoded;
+  h.encode(encoded);
+  EXPECT_FALSE(h.decode(encoded.substr(0, encoded.size() - 1)));
+  EXPECT_FALSE(h.decode(encoded + "x"));
+  EXPECT_TRUE(h.empty());
+}
+
+TEST(BranchHistoryTest, Bytes) {
+  // the former one byte per branch form, with 1 or '1' for taken
+  BranchHistory h;
+  h.push_back(1);
+  h.push_back('0');
+  h.push_back('1');
+  h.push_back(0);
+  EXPECT_EQ('1', h[0]);
+  EXPECT_EQ('0', h[1]);
+  std::vector<unsigned char> bytes = h;
+  EXPECT_EQ((std::vector<unsigned char>{'1', '0', '1', '0'}), bytes);
+  EXPECT_EQ(bytes, std::vector<unsigned char>(h.begin(), h.end()));
+}
+
+} // namespace
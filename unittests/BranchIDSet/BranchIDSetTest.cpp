@@ -0,0 +1,171 @@
+//===-- BranchIDSetTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/BehaviorSet.h"
+#include "klee/Internal/ADT/BranchIDSet.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+std::vector<BranchID> elements(const BranchIDSet &s) {
+  return std::vector<BranchID>(s.begin(), s.end());
+}
+
+TEST(BranchIDSetTest, InsertEraseCount) {
+  BranchIDSet s;
+  EXPECT_TRUE(s.empty());
+  EXPECT_TRUE(s.begin() == s.end());
+
+  EXPECT_TRUE(s.insert(700));
+  EXPECT_TRUE(s.insert(3));
+  EXPECT_FALSE(s.insert(700));
+  EXPECT_TRUE(s.insert(64));
+  EXPECT_EQ(3u, s.size());
+  EXPECT_EQ(1u, s.count(64));
+  EXPECT_EQ(0u, s.count(65));
+  EXPECT_EQ(0u, s.count(100000));
+  EXPECT_EQ((std::vector<BranchID>{3, 64, 700}), elements(s));
+
+  EXPECT_EQ(1u, s.erase(3));
+  EXPECT_EQ(0u, s.erase(3));
+  EXPECT_EQ((std::vector<BranchID>{64, 700}), elements(s));
+  s.erase(64);
+  s.erase(700);
+  EXPECT_TRUE(s.empty());
+}
+
+TEST(BranchIDSetTest, SetOperations) {
+  BranchIDSet a, b;
+  a.insert(1);
+  a.insert(200);
+  b.insert(200);
+  b.insert(5000);
+  EXPECT_TRUE(a.intersects(b));
+
+  BranchIDSet u = a;
+  u |= b;
+  EXPECT_EQ((std::vector<BranchID>{1, 200, 5000}), elements(u));
+
+  BranchIDSet i = a;
+  i &= b;
+  EXPECT_EQ((std::vector<BranchID>{200}), elements(i));
+
+  BranchIDSet c;
+  c.insert(200);
+  EXPECT_EQ(c, i);
+  c.erase(200);
+  EXPECT_FALSE(c.intersects(a));
+}
+
+TEST(BranchIDSetTest, Decisions) {
+  BranchDecisions d;
+  EXPECT_EQ(BranchDecisions::None, d.get(10));
+  d.addTaken(10, true);
+  d.addTaken(1000, false);
+  d.addTaken(10, false);
+  EXPECT_EQ(BranchDecisions::Both, d.get(10));
+  EXPECT_EQ(BranchDecisions::False, d.get(1000));
+  EXPECT_EQ(2u, d.size());
+
+  std::vector<std::pair<BranchID, unsigned char> > seen;
+  d.forEach([&](BranchID id, unsigned char dirs) {
+    seen.emplace_back(id, dirs);
+  });
+  ASSERT_EQ(2u, seen.size());
+  EXPECT_EQ(10u, seen[0].first);
+  EXPECT_EQ(BranchDecisions::Both, seen[0].second);
+  EXPECT_EQ(1000u, seen[1].first);
+
+  BranchDecisions e;
+  e.addTaken(1000, false);
+  EXPECT_NE(d, e);
+  d.erase(10);
+  EXPECT_EQ(1u, d.size());
+  EXPECT_EQ(d, e);
+
+  // an entry may hold any byte, including 0
+  d.set(20, 0);
+  EXPECT_EQ(1u, d.count(20));
+  EXPECT_EQ(0u, d.get(20));
+  EXPECT_NE(d, e);
+  d.set(20, '1');
+  EXPECT_EQ('1', d.get(20));
+  EXPECT_EQ(1u, d.erase(20));
+  EXPECT_EQ(0u, d.erase(20));
+  EXPECT_EQ(d, e);
+}
+
+TEST(BranchIDSetTest, DecisionsHash) {
+  BranchDecisions a, b;
+  EXPECT_EQ(a.getHash(), b.getHash());
+
+  // independent of the order of the decisions
+  a.addTaken(5, true);
+  a.addTaken(900, false);
+  b.addTaken(900, false);
+  b.addTaken(5, true);
+  EXPECT_EQ(a.getHash(), b.getHash());
+
+  b.addTaken(5, false);
+  EXPECT_NE(a.getHash(), b.getHash());
+  b.erase(5);
+  b.addTaken(5, true);
+  EXPECT_EQ(a.getHash(), b.getHash());
+  // adding a known direction changes nothing
+  b.addTaken(5, true);
+  EXPECT_EQ(a.getHash(), b.getHash());
+
+  BehaviorSet behaviors;
+  EXPECT_TRUE(behaviors.insert(a));
+  EXPECT_FALSE(behaviors.insert(b));
+  b.clear();
+  EXPECT_FALSE(behaviors.count(b));
+  EXPECT_TRUE(behaviors.insert(b));
+  EXPECT_EQ(2u, behaviors.size());
+}
+
+TEST(BranchIDSetTest, SetMap) {
+  BranchSetMap m;
+  EXPECT_TRUE(m.insert(7, 1));
+  EXPECT_TRUE(m.insert(3, 2));
+  EXPECT_TRUE(m.insert(7, 4));
+  EXPECT_FALSE(m.insert(7, 4));
+  EXPECT_EQ(2u, m.size());
+  EXPECT_EQ(3u, (*m.begin()).first);
+  ASSERT_NE(nullptr, m.lookup(7));
+  EXPECT_EQ(2u, m.lookup(7)->size());
+  EXPECT_EQ(nullptr, m.lookup(5));
+
+  BranchSetMap copy = m;
+  EXPECT_EQ(copy, m);
+  copy.insert(3, 9);
+  EXPECT_NE(copy, m);
+  EXPECT_EQ(1u, m.lookup(3)->size());
+  EXPECT_EQ(2u, copy.lookup(3)->size());
+  // the untouched entry is still shared
+  EXPECT_EQ(m.lookup(7), copy.lookup(7));
+
+  BranchIDSet extra;
+  extra.insert(11);
+  copy.unite(7, extra);
+  EXPECT_EQ(3u, copy.lookup(7)->size());
+  EXPECT_EQ(2u, m.lookup(7)->size());
+
+  EXPECT_EQ(1u, m.erase(3));
+  EXPECT_EQ(0u, m.erase(3));
+  EXPECT_EQ(1u, m.size());
+  EXPECT_EQ(2u, copy.size());
+}
+
+} // namespace
@@ -0,0 +1,73 @@
+//===-- ErrorTargetsTest.cpp ------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Module/ErrorTargets.h"
+
+#include "gtest/gtest.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(ErrorTargetsTest, Lines) {
+  ErrorTargets targets;
+  std::map<std::string, std::vector<unsigned> > locations;
+  locations["t.c"] = {10, 11};
+  locations["other.c"] = {};
+  targets.addTargets(locations);
+  ASSERT_EQ(3u, targets.getNumTargets());
+  EXPECT_EQ("other.c", targets.getTarget(0).file);
+  EXPECT_EQ(0u, targets.getTarget(0).line);
+
+  std::vector<unsigned> hit;
+  targets.getTargetsAt("/src/t.c", 10, hit);
+  EXPECT_EQ((std::vector<unsigned>{1}), hit);
+  hit.clear();
+  targets.getTargetsAt("/src/t.c", 12, hit);
+  EXPECT_TRUE(hit.empty());
+  // a target without a line matches every line of its file
+  targets.getTargetsAt("/src/other.c", 7, hit);
+  EXPECT_EQ((std::vector<unsigned>{0}), hit);
+}
+
+TEST(ErrorTargetsTest, MarkHit) {
+  ErrorTargets targets;
+  std::map<std::string, std::vector<unsigned> > locations;
+  locations["t.c"] = {10, 11};
+  targets.addTargets(locations);
+
+  EXPECT_EQ(2u, targets.getNumRemainingTargets());
+  EXPECT_TRUE(targets.markHit(0));
+  EXPECT_FALSE(targets.markHit(0));
+  EXPECT_TRUE(targets.isHit(0));
+  EXPECT_FALSE(targets.isHit(1));
+  EXPECT_EQ(1u, targets.getNumRemainingTargets());
+}
+
+TEST(ErrorTargetsTest, MatchesDirectory) {
+  ErrorTargets targets;
+  std::map<std::string, std::vector<unsigned> > locations;
+  locations["/src/t.c"] = {10};
+  locations["./src/t.c"] = {10};
+  locations["lib/t.c"] = {10};
+  locations["rc/t.c"] = {10};
+  targets.addTargets(locations);
+
+  std::vector<unsigned> hit;
+  targets.getTargetsAt("/src/t.c", 10, hit);
+  ASSERT_EQ(2u, hit.size());
+  EXPECT_EQ("./src/t.c", targets.getTarget(hit[0]).file);
+  EXPECT_EQ("/src/t.c", targets.getTarget(hit[1]).file);
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+//===-- PersistentQueryCacheTest.cpp --------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver/PersistentQueryCache.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+std::string makeTempPath() {
+  char path[] = "/tmp/klee-query-cache-XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  close(fd);
+  unlink(path);
+  return path;
+}
+
+PersistentQueryCache::Key makeKey(uint64_t lo, uint64_t hi) {
+  PersistentQueryCache::Key key;
+  key.lo = lo;
+  key.hi = hi;
+  return key;
+}
+
+off_t getFileSize(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+TEST(PersistentQueryCacheTest, SharedBetweenInstances) {
+  std::string path = makeTempPath();
+  std::string error, result;
+  PersistentQueryCache a, b;
+  ASSERT_TRUE(a.open(path, error)) << error;
+  ASSERT_TRUE(b.open(path, error)) << error;
+
+  PersistentQueryCache::Key k1 = makeKey(1, 2), k2 = makeKey(1, 3);
+  EXPECT_FALSE(b.lookup(k1, PersistentQueryCache::Truth, result));
+  EXPECT_TRUE(a.insert(k1, PersistentQueryCache::Truth, "\1"));
+  EXPECT_TRUE(a.insert(k2, PersistentQueryCache::Value, "value"));
+
+  // records appended by another instance are picked up on a miss
+  ASSERT_TRUE(b.lookup(k1, PersistentQueryCache::Truth, result));
+  EXPECT_EQ("\1", result);
+  ASSERT_TRUE(b.lookup(k2, PersistentQueryCache::Value, result));
+  EXPECT_EQ("value", result);
+  // the kind is part of the key
+  EXPECT_FALSE(b.lookup(k1, PersistentQueryCache::Validity, result));
+  EXPECT_EQ(2u, b.getNumHits());
+  EXPECT_EQ(2u, b.getNumMisses());
+
+  // a result is stored only once
+  EXPECT_TRUE(b.insert(k1, PersistentQueryCache::Truth, "\1"));
+  EXPECT_EQ(0u, b.getNumStores());
+  EXPECT_EQ(2u, b.size());
+
+  a.close();
+  b.close();
+  PersistentQueryCache c;
+  ASSERT_TRUE(c.open(path, error)) << error;
+  EXPECT_EQ(2u, c.size());
+  ASSERT_TRUE(c.lookup(k2, PersistentQueryCache::Value, result));
+  EXPECT_EQ("value", result);
+  unlink(path.c_str());
+}
+
+TEST(PersistentQueryCacheTest, TornRecord) {
+  std::string path = makeTempPath();
+  std::string error, result;
+  {
+    PersistentQueryCache a;
+    ASSERT_TRUE(a.open(path, error)) << error;
+    EXPECT_TRUE(a.insert(makeKey(1, 1), PersistentQueryCache::Truth,
+                         llvm::StringRef("\0", 1)));
+    EXPECT_TRUE(a.insert(makeKey(2, 2), PersistentQueryCache::Truth, "\1"));
+  }
+  // cut the last record short, as a crash while appending would
+  off_t size = getFileSize(path);
+  ASSERT_EQ(0, truncate(path.c_str(), size - 2));
+
+  PersistentQueryCache b;
+  ASSERT_TRUE(b.open(path, error)) << error;
+  EXPECT_EQ(1u, b.size());
+  EXPECT_TRUE(b.lookup(makeKey(1, 1), PersistentQueryCache::Truth, result));
+  EXPECT_FALSE(b.lookup(makeKey(2, 2), PersistentQueryCache::Truth, result));
+
+  // the next record overwrites the torn one
+  EXPECT_TRUE(b.insert(makeKey(3, 3), PersistentQueryCache::Truth, "\1"));
+  EXPECT_EQ(size, getFileSize(path));
+  b.close();
+  ASSERT_TRUE(b.open(path, error)) << error;
+  EXPECT_EQ(2u, b.size());
+  EXPECT_TRUE(b.lookup(makeKey(3, 3), PersistentQueryCache::Truth, result));
+  unlink(path.c_str());
+}
+
+TEST(PersistentQueryCacheTest, RejectsOtherFiles) {
+  std::string path = makeTempPath();
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(20, write(fd, "not a query cache...", 20));
+  close(fd);
+
+  std::string error;
+  PersistentQueryCache cache;
+  EXPECT_FALSE(cache.open(path, error));
+  EXPECT_FALSE(cache.isOpen());
+  EXPECT_NE(std::string::npos, error.find("not a query cache"));
+  unlink(path.c_str());
+}
+
+}
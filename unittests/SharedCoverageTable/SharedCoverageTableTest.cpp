@@ -0,0 +1,66 @@
+//===-- SharedCoverageTableTest.cpp ---------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/SharedCoverageTable.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+std::string makeTempPath() {
+  char path[] = "/tmp/klee-shared-coverage-XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  close(fd);
+  unlink(path);
+  return path;
+}
+
+TEST(SharedCoverageTableTest, SharedBetweenMappings) {
+  std::string path = makeTempPath();
+  std::string error;
+  SharedCoverageTable a, b;
+  ASSERT_TRUE(a.open(path, 42, 1000, error)) << error;
+  ASSERT_TRUE(b.open(path, 42, 1000, error)) << error;
+
+  EXPECT_TRUE(a.insertBehavior(0x1234));
+  EXPECT_TRUE(b.containsBehavior(0x1234));
+  EXPECT_FALSE(b.insertBehavior(0x1234));
+  // colliding slots are probed
+  EXPECT_TRUE(b.insertBehavior(0x1234 + 1024));
+  EXPECT_TRUE(a.containsBehavior(0x1234 + 1024));
+  EXPECT_TRUE(a.insertBehavior(0));
+  EXPECT_FALSE(b.insertBehavior(0));
+  EXPECT_FALSE(a.containsBehavior(0x4321));
+
+  a.close();
+  b.close();
+  unlink(path.c_str());
+}
+
+TEST(SharedCoverageTableTest, Mismatch) {
+  std::string path = makeTempPath();
+  std::string error;
+  SharedCoverageTable a, b;
+  ASSERT_TRUE(a.open(path, 42, 1000, error)) << error;
+  EXPECT_FALSE(b.open(path, 43, 1000, error));
+  EXPECT_FALSE(b.isOpen());
+  EXPECT_FALSE(b.open(path, 42, 2000, error));
+  EXPECT_FALSE(error.empty());
+  a.close();
+  unlink(path.c_str());
+}
+
+} // namespace
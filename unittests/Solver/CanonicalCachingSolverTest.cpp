@@ -0,0 +1,101 @@
+//===-- CanonicalCachingSolverTest.cpp ------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/CanonicalCachingSolver.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Answers every query with fixed results and counts the queries.
+class CountingSolverImpl : public SolverImpl {
+  unsigned &queries;
+
+public:
+  explicit CountingSolverImpl(unsigned &_queries) : queries(_queries) {}
+
+  bool computeTruth(const Query &, bool &isValid) {
+    ++queries;
+    isValid = true;
+    return true;
+  }
+  bool computeValue(const Query &, ref<Expr> &result) {
+    ++queries;
+    result = ConstantExpr::create(42, 8);
+    return true;
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    ++queries;
+    values.assign(objects.size(), std::vector<unsigned char>(1, 7));
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+TEST(CanonicalCachingSolverTest, RenamedQueriesShareAnswers) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("arg0", 1);
+  const Array *renamed = ac.CreateArray("arg0_1", 1);
+  const Array *other = ac.CreateArray("arg1", 4);
+  ref<Expr> c10 = ConstantExpr::create(10, 8);
+
+  unsigned queries = 0;
+  CanonicalCachingSolver *cache =
+      new CanonicalCachingSolver(new Solver(new CountingSolverImpl(queries)));
+  Solver solver(cache);
+
+  ConstraintManager cm({UltExpr::create(Expr::createTempRead(a, 8), c10)});
+  ConstraintManager renamedCm(
+      {UltExpr::create(Expr::createTempRead(renamed, 8), c10)});
+  ref<Expr> expr = EqExpr::create(Expr::createTempRead(a, 8), c10);
+  ref<Expr> renamedExpr = EqExpr::create(Expr::createTempRead(renamed, 8), c10);
+
+  bool result;
+  ASSERT_TRUE(solver.mustBeTrue(Query(cm, expr), result));
+  ASSERT_TRUE(solver.mustBeTrue(Query(renamedCm, renamedExpr), result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(1u, queries);
+
+  // another kind of answer for the same query is a different entry
+  ref<ConstantExpr> value;
+  ASSERT_TRUE(solver.getValue(Query(cm, expr), value));
+  ASSERT_TRUE(solver.getValue(Query(renamedCm, renamedExpr), value));
+  EXPECT_EQ(42u, value->getZExtValue());
+  EXPECT_EQ(2u, queries);
+
+  // initial values are keyed by the objects too
+  std::vector<std::vector<unsigned char> > values;
+  ASSERT_TRUE(solver.getInitialValues(Query(cm, expr), {a}, values));
+  ASSERT_TRUE(
+      solver.getInitialValues(Query(renamedCm, renamedExpr), {renamed}, values));
+  EXPECT_EQ(3u, queries);
+  ASSERT_TRUE(solver.getInitialValues(Query(cm, expr), {a, other}, values));
+  EXPECT_EQ(4u, queries);
+  ASSERT_EQ(2u, values.size());
+
+  EXPECT_EQ(3u, cache->getNumHits());
+  EXPECT_EQ(4u, cache->getNumMisses());
+}
+
+} // namespace
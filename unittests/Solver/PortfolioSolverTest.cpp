@@ -0,0 +1,98 @@
+//===-- PortfolioSolverTest.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/PortfolioSolver.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// Answers every truth query with a fixed result after a delay, or fails.
+class FakeSolverImpl : public SolverImpl {
+  unsigned delayMs;
+  bool succeed;
+  bool answer;
+
+public:
+  FakeSolverImpl(unsigned _delayMs, bool _succeed, bool _answer = false)
+      : delayMs(_delayMs), succeed(_succeed), answer(_answer) {}
+
+  bool computeTruth(const Query &, bool &isValid) {
+    usleep(delayMs * 1000);
+    isValid = answer;
+    return succeed;
+  }
+  bool computeValue(const Query &, ref<Expr> &) { return false; }
+  bool computeInitialValues(const Query &, const std::vector<const Array *> &,
+                            std::vector<std::vector<unsigned char> > &,
+                            bool &) {
+    return false;
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return succeed ? SOLVER_RUN_STATUS_SUCCESS_SOLVABLE
+                   : SOLVER_RUN_STATUS_FAILURE;
+  }
+};
+
+Solver *createFakeSolver(unsigned delayMs, bool succeed, bool answer = false) {
+  return new Solver(new FakeSolverImpl(delayMs, succeed, answer));
+}
+
+TEST(PortfolioSolverTest, FirstAnswerWins) {
+  std::vector<PortfolioSolver::Backend> backends;
+  // the slow backend would answer differently; it must be cancelled
+  backends.emplace_back("slow", createFakeSolver(5000, true, false));
+  backends.emplace_back("fast", createFakeSolver(10, true, true));
+  PortfolioSolver portfolio(std::move(backends));
+
+  ConstraintManager constraints;
+  Query query(constraints, ref<Expr>());
+  bool isValid = false;
+  time::Point start = time::getWallTime();
+  ASSERT_TRUE(portfolio.computeTruth(query, isValid));
+  EXPECT_TRUE(isValid);
+  EXPECT_LT((time::getWallTime() - start).toSeconds(), 2.0);
+  EXPECT_EQ(0u, portfolio.getBackends()[0].wins);
+  EXPECT_EQ(1u, portfolio.getBackends()[1].wins);
+}
+
+TEST(PortfolioSolverTest, FailuresDoNotEndTheRace) {
+  std::vector<PortfolioSolver::Backend> backends;
+  backends.emplace_back("failing", createFakeSolver(0, false));
+  backends.emplace_back("working", createFakeSolver(50, true, true));
+  PortfolioSolver portfolio(std::move(backends));
+
+  ConstraintManager constraints;
+  Query query(constraints, ref<Expr>());
+  bool isValid = false;
+  ASSERT_TRUE(portfolio.computeTruth(query, isValid));
+  EXPECT_TRUE(isValid);
+  EXPECT_EQ(1u, portfolio.getBackends()[0].failures);
+  EXPECT_EQ(1u, portfolio.getBackends()[1].wins);
+  EXPECT_EQ(SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE,
+            portfolio.getOperationStatusCode());
+
+  std::vector<PortfolioSolver::Backend> failing;
+  failing.emplace_back("a", createFakeSolver(0, false));
+  failing.emplace_back("b", createFakeSolver(0, false));
+  PortfolioSolver hopeless(std::move(failing));
+  EXPECT_FALSE(hopeless.computeTruth(query, isValid));
+  EXPECT_EQ(SolverImpl::SOLVER_RUN_STATUS_FAILURE,
+            hopeless.getOperationStatusCode());
+}
+
+}
@@ -0,0 +1,104 @@
+//===-- QueryCanonicalizerTest.cpp ----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/QueryCanonicalizer.h"
+#include "klee/Solver/Solver.h"
+
+#include <string>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+std::string getForm(const ConstraintManager &constraints, ref<Expr> expr,
+                    const std::vector<const Array *> *objects = nullptr) {
+  QueryCanonicalizer canonicalizer;
+  canonicalizer.canonicalize(Query(constraints, expr), objects);
+  return canonicalizer.getForm();
+}
+
+class QueryCanonicalizerTest : public ::testing::Test {
+protected:
+  ArrayCache ac;
+  const Array *a, *b, *renamedA, *renamedB, *other;
+  ref<Expr> readA, readB, readRenamedA, readRenamedB, readOther;
+  ref<Expr> c10;
+
+  void SetUp() override {
+    a = ac.CreateArray("arg0", 4);
+    b = ac.CreateArray("arg1", 8);
+    renamedA = ac.CreateArray("arg0_1", 4);
+    renamedB = ac.CreateArray("arg1_1", 8);
+    other = ac.CreateArray("arg2", 4);
+    readA = Expr::createTempRead(a, 8);
+    readB = Expr::createTempRead(b, 8);
+    readRenamedA = Expr::createTempRead(renamedA, 8);
+    readRenamedB = Expr::createTempRead(renamedB, 8);
+    readOther = Expr::createTempRead(other, 8);
+    c10 = ConstantExpr::create(10, 8);
+  }
+};
+
+TEST_F(QueryCanonicalizerTest, RenamedArrays) {
+  ConstraintManager cm({UltExpr::create(readA, c10)});
+  ConstraintManager renamed({UltExpr::create(readRenamedA, c10)});
+  EXPECT_EQ(getForm(cm, UltExpr::create(readB, readA)),
+            getForm(renamed, UltExpr::create(readRenamedB, readRenamedA)));
+  // the same array twice is not two different arrays
+  EXPECT_NE(getForm(cm, UltExpr::create(readA, readA)),
+            getForm(cm, UltExpr::create(readA, readOther)));
+  // constant arrays are compared by contents
+  ref<ConstantExpr> values[] = {ConstantExpr::create(1, 8),
+                                ConstantExpr::create(2, 8)};
+  const Array *table = ac.CreateArray("table", 2, values, values + 2);
+  const Array *table2 = ac.CreateArray("table_1", 2, values, values + 2);
+  ConstraintManager empty;
+  EXPECT_EQ(getForm(empty, EqExpr::create(readA, Expr::createTempRead(table, 8))),
+            getForm(empty, EqExpr::create(readRenamedA,
+                                          Expr::createTempRead(table2, 8))));
+}
+
+TEST_F(QueryCanonicalizerTest, OperandOrder) {
+  ConstraintManager empty;
+  EXPECT_EQ(getForm(empty, UltExpr::create(AddExpr::create(readA, readB), c10)),
+            getForm(empty, UltExpr::create(AddExpr::create(readB, readA), c10)));
+  EXPECT_NE(getForm(empty, UltExpr::create(SubExpr::create(readA, readB), c10)),
+            getForm(empty, UltExpr::create(SubExpr::create(readB, readA), c10)));
+}
+
+TEST_F(QueryCanonicalizerTest, ConstraintOrder) {
+  ref<Expr> c1 = UltExpr::create(readA, c10);
+  ref<Expr> c2 = UltExpr::create(c10, readB);
+  ConstraintManager cm12({c1, c2}), cm21({c2, c1});
+  EXPECT_EQ(getForm(cm12, EqExpr::create(readA, readB)),
+            getForm(cm21, EqExpr::create(readA, readB)));
+  ConstraintManager cm1({c1});
+  EXPECT_NE(getForm(cm12, EqExpr::create(readA, readB)),
+            getForm(cm1, EqExpr::create(readA, readB)));
+}
+
+TEST_F(QueryCanonicalizerTest, Objects) {
+  ConstraintManager cm({UltExpr::create(readA, readB)});
+  std::vector<const Array *> ab = {a, b}, ba = {b, a},
+                             renamed = {renamedA, renamedB};
+  ConstraintManager renamedCm({UltExpr::create(readRenamedA, readRenamedB)});
+  ref<Expr> f = ConstantExpr::alloc(0, Expr::Bool);
+  EXPECT_EQ(getForm(cm, f, &ab), getForm(renamedCm, f, &renamed));
+  // values are returned by position
+  EXPECT_NE(getForm(cm, f, &ab), getForm(cm, f, &ba));
+  EXPECT_NE(getForm(cm, f, &ab), getForm(cm, f));
+}
+
+}